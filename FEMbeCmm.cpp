@@ -1,30 +1,708 @@
 //#include "stdafx.h"
 #include "FEMbeCmm.h"
+#include "GRVoigt.h"
+#include "GRMath.h"
 #include "FEBioMech/FEElasticMaterial.h"
 #include "FECore/FEAnalysis.h"					// to get end time
+#include "FECore/FETimeStepController.h"		// to cap the auto time step
 #include "FECore/FEModel.h"						// to get current time
 #include "FECore/log.h"							// to print to log file and/or screen
+#include "FECore/FEMesh.h"						// to access the material points and nodes
+#include "FECore/FEDomain.h"
 #include <iostream>								// to use cin.get()
 #include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <signal.h>
+#include <sys/mman.h>							// to map snapshot files
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #define _USE_MATH_DEFINES						// to introduce pi constant (1/2)
 #include <math.h>								// to introduce pi constant (2/2)
 
+// geometry of the reference configuration and constants shared by the local frame
+// initialization and the material evaluation
+static const double imper  = 0.00;			// imper > 0 for TORTUOSITY (see Matlab script <NodesElementsAsy.m>) | 0.00 | 20.0
+static const double rIo    = 0.6468;		// 0.6468 | 0.5678
+static const double hwaves = 2.0;
+static const double lo     = 30.0;
+
+static const double phieo  = 0.34;			// 0.34 (CMAME | KNOCKOUTS) | 1.00 (TEVG) | 1.0/3.0 (TEVG)
+static const double mu     = 89.71;
+static const double Get    = 1.90;
+static const double Gez    = 1.62;
+
+static const double alphao = 0.522;			// original orientation of diagonal collagen | 0.522 (CMAME | KNOCKOUTS) | 0.8713 (TEVG)
+static const double sinao  = sin(alphao);	// original diagonal fiber directions Np/Nn = N[1]*sin(alphao) +/- N[2]*cos(alphao)
+static const double cosao  = cos(alphao);
+
+// active tone constants (at namespace scope, so the kernels need no guarded static initialization)
+static const double CB     = sqrt(log(2.0));			// such that (1-exp(-CB^2)) = 0.5
+static const double CS     = 0.5*CB * 1.0;				// such that (1-exp( -C^2)) = 0.0 for lt = 1/(1+CB/CS)^(1/3) = 0.7 and (1-exp(-C^2)) = 0.75 for lt = 2.0
+static const double aCB    = 1.0-exp(-CB*CB);			// homeostatic active tone factor
+
 // define the material parameters
 BEGIN_FECORE_CLASS(FEMbeCmm, FEElasticMaterial)
     ADD_PARAMETER(m_secant_tangent, "secant_tangent");
+	ADD_PARAMETER(m_cache, "result_cache");
+
+	ADD_PARAMETER(m_lagTangent, "lagged_tangent");
+	ADD_PARAMETER(m_lagTol, FE_RANGE_GREATER_OR_EQUAL(0.0), "lagged_tangent_tol");
+
+	// regime constants
+	ADD_PARAMETER(m_Tmax  , FE_RANGE_GREATER_OR_EQUAL(0.0), "Tmax");
+	ADD_PARAMETER(m_eta   , FE_RANGE_GREATER(0.0), "eta");
+	ADD_PARAMETER(m_aexp  , "aexp");
+	ADD_PARAMETER(m_delta , FE_RANGE_RIGHT_OPEN(0.0, 1.0), "delta");
+	ADD_PARAMETER(m_KfKi  , "KfKi");
+	ADD_PARAMETER(m_inflam, "inflam");
+	ADD_PARAMETER(m_EPS   , FE_RANGE_GREATER(0.0), "EPS");
+	ADD_PARAMETER(m_KsKi  , FE_RANGE_GREATER_OR_EQUAL(0.0), "KsKi");
+	ADD_PARAMETER(m_cc    , FE_RANGE_GREATER(0.0), "cc");
+	ADD_PARAMETER(m_dc    , FE_RANGE_GREATER_OR_EQUAL(0.0), "dc");
+	ADD_PARAMETER(m_betat , FE_RANGE_CLOSED(0.0, 1.0), "betat");
+	ADD_PARAMETER(m_betaz , FE_RANGE_CLOSED(0.0, 1.0), "betaz");
+
+	ADD_PARAMETER(m_phicMaxIter, FE_RANGE_GREATER(0), "phic_max_iters");
+
+	ADD_PARAMETER(m_stats, "statistics");
+	ADD_PARAMETER(m_statsFile, "statistics_file");
+
+	ADD_PARAMETER(m_snapshotSave, "homeostatic_save");
+	ADD_PARAMETER(m_snapshotLoad, "homeostatic_load");
+
+	ADD_PARAMETER(m_ensembleFile, "ensemble_file");
+	ADD_PARAMETER(m_ensembleOutput, "ensemble_output");
+
+	ADD_PARAMETER(m_fanoutFile, "fanout_file");
+	ADD_PARAMETER(m_fanoutTime, "fanout_time");
+	ADD_PARAMETER(m_fanoutJobs, FE_RANGE_GREATER_OR_EQUAL(0), "fanout_jobs");
+	ADD_PARAMETER(m_fanoutOutput, "fanout_output");
+
+	ADD_PARAMETER(m_centerlineFile, "centerline_file");
+
+	ADD_PARAMETER(m_adapt, "adaptive_step");
+	ADD_PARAMETER(m_dphicTol  , FE_RANGE_GREATER(0.0), "dphic_tol");
+	ADD_PARAMETER(m_dJJoTol   , FE_RANGE_GREATER(0.0), "dJJo_tol");
+	ADD_PARAMETER(m_drIrIoTol , FE_RANGE_GREATER(0.0), "drIrIo_tol");
+	ADD_PARAMETER(m_adaptDtMin, FE_RANGE_GREATER(0.0), "adaptive_dtmin");
+	ADD_PARAMETER(m_adaptDtMax, FE_RANGE_GREATER(0.0), "adaptive_dtmax");
 END_FECORE_CLASS();
 
 FEMbeCmm::FEMbeCmm(FEModel* pfem) : FEElasticMaterial(pfem)
 {
     m_secant_tangent = true;
+
+	m_cache = false;
+
+	m_lagTangent = false;
+	m_lagTol = 1.0e-3;
+
+	m_Tmax   = 250.0 * 0.0;		// 250.0 | 50.0 | 150.0 (for uniform cases, except for contractility -> 250)
+	m_eta    = 1.0;				// 1.0 | 1.0/3.0 (for uniform cases) | 0.714
+	m_aexp   = 1.0;				// 1.0 (KNOCKOUTS | TEVG) | 0.0 (CMAME | TORTUOSITY)
+	m_delta  = 0.0;
+	m_KfKi   = 1.0;
+	m_inflam = 0.0;
+	m_EPS    = 1.0;
+	m_KsKi   = 0.35;
+	m_cc     = 234.9;			// 234.9 (CMAME | KNOCKOUTS) | 328.475 (TEVG)
+	m_dc     = 4.08;
+	m_betat  = 0.056;
+	m_betaz  = 0.067;
+
+	m_phicMaxIter = 50;
+
+	m_stats = false;
+
+	m_fanoutTime = 1.0;
+	m_fanoutJobs = 0;
+	m_fanoutOutput = "fanout";
+	m_scenario = -1;
+	m_tfanout = 0.0;
+
+	m_adapt      = false;
+	m_dphicTol   = 0.005;
+	m_dJJoTol    = 0.01;
+	m_drIrIoTol  = 0.01;
+	m_adaptDtMin = 0.05;
+	m_adaptDtMax = 5.0;
+
+	// one slot per thread the element loops may run on (indexed modulo m_ntc, so any team size is safe)
+#ifdef _OPENMP
+	m_ntc = std::max(std::max(omp_get_max_threads(), omp_get_num_procs()), 1);
+#else
+	m_ntc = 1;
+#endif
+	// plus one slot for the ensemble evaluations, which are not part of the solution
+	m_tc = new GRThreadCounters[m_ntc + 1];
+	for (int i = 0; i <= m_ntc; i++) {
+		GRThreadCounters& tc = m_tc[i];
+		tc.stat.Reset();
+		tc.ncacheHit = tc.ncacheMiss = tc.nphicFail = tc.nlagReuse = tc.nlagEval = 0;
+	}
+
+	m_bcallback = false;
+	m_bstatsHeader = false;
+	m_bsnapshotSaved = false;
+	m_bensembleHeader = false;
+	m_bensembleEval = false;
+	m_stepperDtMax = -1.0;
+	m_stepperDtCap = -1.0;
+}
+
+FEMbeCmm::~FEMbeCmm()
+{
+	delete [] m_tc;
+}
+
+// index of the calling thread in the current parallel region
+static inline int GRThread()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+GRThreadCounters& FEMbeCmm::Counters()
+{
+	return (m_bensembleEval ? m_tc[m_ntc] : m_tc[GRThread() % m_ntc]);
+}
+
+void GRStatistics::Reset()
+{
+	for (int i = 0; i < 2; i++) { ncall[i][0] = 0; ncall[i][1] = 0; }
+	for (int i = 0; i < GR_PHIC_BINS; i++) nphicIter[i] = 0;
+	nphicBisect = 0;
+	tframe = 0;
+	tkinematics = 0;
+	tkernel[0] = tkernel[1] = 0;
+	tphic = 0;
+}
+
+void GRStatistics::Collect(GRStatistics& st)
+{
+	for (int i = 0; i < 2; i++) { ncall[i][0] += st.ncall[i][0].exchange(0); ncall[i][1] += st.ncall[i][1].exchange(0); }
+	for (int i = 0; i < GR_PHIC_BINS; i++) nphicIter[i] += st.nphicIter[i].exchange(0);
+	nphicBisect += st.nphicBisect.exchange(0);
+	tframe += st.tframe.exchange(0);
+	tkinematics += st.tkinematics.exchange(0);
+	tkernel[0] += st.tkernel[0].exchange(0);
+	tkernel[1] += st.tkernel[1].exchange(0);
+	tphic += st.tphic.exchange(0);
+}
+
+// time stamp in ns for the statistics
+static inline long long GRClock()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// callback for loading the homeostatic snapshot after model initialization, for reporting the
+// material statistics, adapting the time step, saving the homeostatic snapshot and forking the
+// scenario workers at the end of each time step, and for collecting the workers at the end of the run
+static bool FEMbeCmm_cb(FEModel* pfem, unsigned int nwhen, void* pd)
+{
+	FEMbeCmm* pmat = (FEMbeCmm*) pd;
+
+	const bool bfanout = !pmat->m_scenarios.empty() && (pmat->m_scenario < 0) && (pfem->GetTime().currentTime >= pmat->m_fanoutTime - 1e-9);
+
+	if (nwhen == CB_INIT) {
+		if (!pmat->m_snapshotLoad.empty() && !pmat->LoadSnapshot(pmat->m_snapshotLoad.c_str())) return false;
+
+		// a run that starts at (or after) the branch time, e.g. from a snapshot, fans out right away
+		const bool bstart = !pmat->m_scenarios.empty() && (pfem->GetTime().currentTime >= pmat->m_fanoutTime - 1e-9);
+		return (bstart ? pmat->FanOut() : true);
+	}
+
+	if (nwhen == CB_SOLVED) {
+		pmat->CollectScenarios();
+		return true;
+	}
+
+	if (!pmat->m_ensemble.empty()) pmat->ReportEnsemble();
+
+	pmat->ReportStatistics();
+
+	pmat->AdaptTimeStep();
+
+	// save the state at the end of prestressing (t = 1)
+	const double t = pfem->GetTime().currentTime;
+	if (!pmat->m_snapshotSave.empty() && !pmat->m_bsnapshotSaved && (fabs(t - 1.0) <= 1e-9)) {
+		if (!pmat->SaveSnapshot(pmat->m_snapshotSave.c_str())) return false;
+		pmat->m_bsnapshotSaved = true;
+	}
+
+	if (bfanout) return pmat->FanOut();
+
+	if (pmat->m_scenario >= 0) pmat->WriteScenarioStep();
+
+	return true;
+}
+
+bool FEMbeCmm::Init()
+{
+	if (!m_bcallback) {
+		GetFEModel()->AddCallback(FEMbeCmm_cb, CB_INIT | CB_MAJOR_ITERS | CB_SOLVED, (void*) this);
+		m_bcallback = true;
+	}
+
+	// the remaining collagen is diagonal (betad = (1 - betat - betaz)/2)
+	if (m_betat + m_betaz > 1.0) { feLogError("mbe_cmm: betat + betaz must not exceed 1\n"); return false; }
+
+	if (!m_ensembleFile.empty() && !ReadEnsemble(m_ensembleFile.c_str())) return false;
+
+	if (!m_fanoutFile.empty() && !ReadScenarios(m_fanoutFile.c_str())) return false;
+
+	if (!m_centerlineFile.empty()) {
+		std::string err;
+		if (!m_centerline.Load(m_centerlineFile.c_str(), err)) { feLogError("mbe_cmm: %s\n", err.c_str()); return false; }
+		feLog("mbe_cmm: %d center line nodes read from %s\n", m_centerline.Nodes(), m_centerlineFile.c_str());
+	}
+
+	return FEElasticMaterial::Init();
+}
+
+// reads the parameter sets of the ensemble, one line per member with
+// KsKi eta cc dc betat betaz alpha ('#' starts a comment)
+bool FEMbeCmm::ReadEnsemble(const char* szfile)
+{
+	FILE* fp = fopen(szfile, "rt");
+	if (fp == nullptr) { feLogError("mbe_cmm: cannot open ensemble file %s\n", szfile); return false; }
+
+	m_ensemble.clear();
+	char szline[1024];
+	int nline = 0;
+	while (fgets(szline, sizeof(szline), fp))
+	{
+		nline++;
+		char* ch = strchr(szline, '#');
+		if (ch) *ch = 0;
+
+		GRParams par;
+		const int n = sscanf(szline, "%lg %lg %lg %lg %lg %lg %lg", &par.KsKi, &par.eta, &par.cc, &par.dc, &par.betat, &par.betaz, &par.alpha);
+		if (n <= 0) continue;
+		if ((n != 7) || (par.eta <= 0.0)) {
+			feLogError("mbe_cmm: invalid parameter set in line %d of %s\n", nline, szfile);
+			fclose(fp);
+			return false;
+		}
+		m_ensemble.push_back(par);
+	}
+	fclose(fp);
+
+	feLog("mbe_cmm: %d ensemble members read from %s\n", (int) m_ensemble.size(), szfile);
+	return true;
+}
+
+// evaluates the ensemble at the converged state of all points and reports, per member, the mean and maximum
+// circumferential stress and the mean stress deviation from the nominal parameter set (member 0)
+void FEMbeCmm::ReportEnsemble()
+{
+	const int K = (int) m_ensemble.size() + 1;
+
+	std::vector<GRParams> par(K);
+	par[0] = NominalParams();
+	for (int k = 1; k < K; k++) par[k] = m_ensemble[k - 1];
+
+	std::vector<FEMaterialPoint*> mp;
+	MaterialPoints(mp);
+	if (mp.empty()) return;
+
+	// count the ensemble evaluations in their own slot, so they do not show up in the solver statistics
+	GRThreadCounters& tc = m_tc[m_ntc];
+	tc.stat.Reset();
+	tc.nphicFail = 0;
+	m_bensembleEval = true;
+
+	std::vector<mat3ds> s(K);
+	std::vector<double> stt(K, 0.0), sttmax(K, -std::numeric_limits<double>::max()), dev(K, 0.0);
+	for (size_t i = 0; i < mp.size(); i++)
+	{
+		StressTangentEnsemble(*mp[i], &par[0], K, &s[0], nullptr);
+
+		const mat3d& F = mp[i]->ExtractData<FEElasticMaterialPoint>()->m_F;
+		const vec3d  n = F*vec3d(LocalFrame(*mp[i]).N[1]);
+		const double s0 = s[0].norm();
+		for (int k = 0; k < K; k++) {
+			const double sk = s[k].dotdot(dyad(n))/n.norm2();
+			stt[k] += sk;
+			sttmax[k] = std::max(sttmax[k], sk);
+			if (s0 > 0.0) dev[k] += (s[k] - s[0]).norm()/s0;
+		}
+	}
+	m_bensembleEval = false;
+
+	const long nfail = tc.nphicFail.exchange(0);
+	if (nfail > 0) feLogWarning("mbe_cmm: phic did not converge within %d iterations at %ld ensemble evaluations\n", m_phicMaxIter, nfail);
+
+	const double t = GetFEModel()->GetTime().currentTime;
+	const double np = (double) mp.size();
+
+	FILE* fp = nullptr;
+	if (!m_ensembleOutput.empty()) {
+		fp = fopen(m_ensembleOutput.c_str(), (m_bensembleHeader ? "at" : "wt"));
+		if (fp == nullptr) feLogWarning("mbe_cmm: cannot write ensemble file %s\n", m_ensembleOutput.c_str());
+		else if (!m_bensembleHeader) {
+			fprintf(fp, "time,member,mean_stt,max_stt,mean_rel_dev\n");
+			m_bensembleHeader = true;
+		}
+	}
+
+	feLog("mbe_cmm ensemble at t = %lg (member, mean / max circumferential stress, mean relative deviation)\n", t);
+	for (int k = 0; k < K; k++) {
+		feLog("\t%3d %13.6lg %13.6lg %13.6lg\n", k, stt[k]/np, sttmax[k], dev[k]/np);
+		if (fp) fprintf(fp, "%lg,%d,%lg,%lg,%lg\n", t, k, stt[k]/np, sttmax[k], dev[k]/np);
+	}
+	if (fp) fclose(fp);
+}
+
+void FEMbeCmm::ReportStatistics()
+{
+	// sum (and reset) the counters of all threads
+	GRStatistics st;
+	st.Reset();
+	long nhit = 0, nmiss = 0, nfail = 0, nreuse = 0, neval = 0;
+	for (int i = 0; i < m_ntc; i++)
+	{
+		GRThreadCounters& tc = m_tc[i];
+		st.Collect(tc.stat);
+		nhit   += tc.ncacheHit.exchange(0);
+		nmiss  += tc.ncacheMiss.exchange(0);
+		nfail  += tc.nphicFail.exchange(0);
+		nreuse += tc.nlagReuse.exchange(0);
+		neval  += tc.nlagEval.exchange(0);
+	}
+
+	const long ntot = nhit + nmiss;
+	if (m_cache) feLog("mbe_cmm result cache: %ld hits, %ld misses (%.1f%% hit rate)\n", nhit, nmiss, (ntot > 0 ? 100.0*nhit/ntot : 0.0));
+
+	if (m_lagTangent) feLog("mbe_cmm lagged tangent: %ld reused, %ld recomputed\n", nreuse, neval);
+
+	if (nfail > 0) feLogWarning("mbe_cmm: phic did not converge within %d iterations at %ld evaluations\n", m_phicMaxIter, nfail);
+
+	if (!m_stats) return;
+
+	const double t = GetFEModel()->GetTime().currentTime;
+
+	feLog("mbe_cmm statistics at t = %lg\n", t);
+	feLog("\tevaluations     : prestress %ld stress, %ld stress+tangent | G&R %ld stress, %ld stress+tangent\n",
+		(long) st.ncall[0][0], (long) st.ncall[0][1], (long) st.ncall[1][0], (long) st.ncall[1][1]);
+	feLog("\tphic iterations :");
+	for (int i = 0; i < GR_PHIC_BINS; i++) feLog(" %d%s:%ld", i, (i == GR_PHIC_BINS - 1 ? "+" : ""), (long) st.nphicIter[i]);
+	feLog("\n");
+	feLog("\tsafeguards      : %ld phic bisection steps, %ld phic solves not converged\n", (long) st.nphicBisect, nfail);
+	feLog("\ttime [ms]       : frame %.3lf, kinematics %.3lf (incl. frame), prestress %.3lf, G&R %.3lf (phic %.3lf)\n",
+		1e-6*st.tframe, 1e-6*st.tkinematics, 1e-6*st.tkernel[0], 1e-6*st.tkernel[1], 1e-6*st.tphic);
+
+	if (!m_statsFile.empty()) {
+		FILE* fp = fopen(m_statsFile.c_str(), (m_bstatsHeader ? "at" : "wt"));
+		if (fp == nullptr) feLogWarning("mbe_cmm: cannot write statistics file %s\n", m_statsFile.c_str());
+		else {
+			if (!m_bstatsHeader) {
+				fprintf(fp, "time,pre_stress,pre_tangent,gr_stress,gr_tangent");
+				for (int i = 0; i < GR_PHIC_BINS; i++) fprintf(fp, ",phic_it%d", i);
+				fprintf(fp, ",phic_bisect,phic_fail,t_frame_ms,t_kinematics_ms,t_prestress_ms,t_gr_ms,t_phic_ms\n");
+				m_bstatsHeader = true;
+			}
+			fprintf(fp, "%lg,%ld,%ld,%ld,%ld", t, (long) st.ncall[0][0], (long) st.ncall[0][1], (long) st.ncall[1][0], (long) st.ncall[1][1]);
+			for (int i = 0; i < GR_PHIC_BINS; i++) fprintf(fp, ",%ld", (long) st.nphicIter[i]);
+			fprintf(fp, ",%ld,%ld,%.3lf,%.3lf,%.3lf,%.3lf,%.3lf\n", (long) st.nphicBisect, nfail,
+				1e-6*st.tframe, 1e-6*st.tkinematics, 1e-6*st.tkernel[0], 1e-6*st.tkernel[1], 1e-6*st.tphic);
+			fclose(fp);
+		}
+	}
+}
+
+// the changes of phic, J/Jo and rIrIo over a G&R step are roughly proportional to the step size, so the next
+// step is scaled by the ratio of the tolerance to the largest change (limited to a factor 1/4 to 2 per step).
+// with FEBio's time stepper on, its controller sets the time step after this callback, so the suggested
+// step caps the controller's dtmax instead (the stepper's own dtmax, must points and iteration control still apply)
+void FEMbeCmm::AdaptTimeStep()
+{
+	if (!m_adapt) return;
+
+	FEModel* fem = GetFEModel();
+	FEAnalysis* step = fem->GetCurrentStep();
+	FETimeStepController* tsc = step->m_timeController;
+
+	const double eps = std::numeric_limits<double>::epsilon();
+	const double t  = fem->GetTime().currentTime;
+	const double dt = fem->GetTime().timeIncrement;
+	const bool bprestress = (t <= 1.0 + eps);
+
+	std::vector<FEMaterialPoint*> mp;
+	MaterialPoints(mp);
+
+	double dphic = 0.0, dJJo = 0.0, drIrIo = 0.0;
+	for (size_t i = 0; i < mp.size(); i++)
+	{
+		GRMaterialPoint& pt = *mp[i]->ExtractData<GRMaterialPoint>();
+		const double J = mp[i]->ExtractData<FEElasticMaterialPoint>()->m_J;
+
+		// Jo is committed from the converged prestress state, so J/Jo = 1 at its end
+		const double JJo = (bprestress ? 1.0 : J/pt.m_Jo);
+		const double rIrIo = (bprestress ? 1.0 : (double) pt.m_rIrIo);
+
+		if (!bprestress) {
+			dphic  = std::max(dphic , fabs(pt.m_phicT - pt.m_phic));
+			dJJo   = std::max(dJJo  , fabs(JJo - pt.m_JJoP));
+			drIrIo = std::max(drIrIo, fabs(rIrIo - pt.m_rIrIoP));
+		}
+
+		pt.m_JJoP = JJo;
+		pt.m_rIrIoP = rIrIo;
+	}
+	if (bprestress || mp.empty() || (dt <= 0.0)) return;
+
+	const double r = std::max(dphic/m_dphicTol, std::max(dJJo/m_dJJoTol, drIrIo/m_drIrIoTol));
+	const double f = (r > 0.5 ? std::max(1.0/r, 0.25) : 2.0);
+	double dtn = std::min(std::max(f*dt, m_adaptDtMin), m_adaptDtMax);
+
+	if (step->m_tend - t > eps) dtn = std::min(dtn, step->m_tend - t);
+	if (tsc) {
+		// a dtmax other than the last cap was set by the input or its load curve
+		if (tsc->m_dtmax != m_stepperDtCap) m_stepperDtMax = tsc->m_dtmax;
+		m_stepperDtCap = tsc->m_dtmax = std::min(dtn, m_stepperDtMax);
+	}
+	else step->m_dt = dtn;
+
+	feLog("mbe_cmm adaptive step at t = %lg: max change phic %lg, J/Jo %lg, rIrIo %lg -> dt = %lg\n", t, dphic, dJJo, drIrIo, dtn);
+}
+
+// collects the material points of all domains of this material (in mesh order)
+void FEMbeCmm::MaterialPoints(std::vector<FEMaterialPoint*>& mp)
+{
+	mp.clear();
+	FEMesh& mesh = GetFEModel()->GetMesh();
+	for (int i = 0; i < mesh.Domains(); i++)
+	{
+		FEDomain& dom = mesh.Domain(i);
+		if (dom.GetMaterial() != this) continue;
+
+		for (int j = 0; j < dom.Elements(); j++)
+		{
+			FEElement& el = dom.ElementRef(j);
+			for (int n = 0; n < el.GaussPoints(); n++) mp.push_back(el.GetMaterialPoint(n));
+		}
+	}
+}
+
+// binary layout of the homeostatic snapshot (native byte order): header, one record per
+// material point (in mesh order), then the nodal displacements
+static const char GR_SNAPSHOT_MAGIC[8] = {'G','R','S','N','A','P','\0','\0'};
+static const int  GR_SNAPSHOT_VERSION = 1;
+
+struct GRSnapshotHeader
+{
+	char	magic[8];
+	int		version;
+	int		npoints;		// number of material points
+	int		nnodes;			// number of nodes
+	int		reserved;
+	double	time;			// time of the snapshot
+};
+
+struct GRSnapshotPoint
+{
+	double	r0[3];			// reference position (for validation)
+	double	Jo;				// the committed history, as in GRMaterialPoint::Serialize
+	double	Fio[9];
+	double	svo;
+	double	phic;
+};
+
+// writes the homeostatic state of all material points and the nodal displacements
+bool FEMbeCmm::SaveSnapshot(const char* szfile)
+{
+	FEModel& fem = *GetFEModel();
+	FEMesh& mesh = fem.GetMesh();
+
+	std::vector<FEMaterialPoint*> mp;
+	MaterialPoints(mp);
+
+	FILE* fp = fopen(szfile, "wb");
+	if (fp == nullptr) { feLogError("mbe_cmm: cannot write homeostatic snapshot %s\n", szfile); return false; }
+
+	GRSnapshotHeader hdr;
+	memcpy(hdr.magic, GR_SNAPSHOT_MAGIC, 8);
+	hdr.version = GR_SNAPSHOT_VERSION;
+	hdr.npoints = (int) mp.size();
+	hdr.nnodes = mesh.Nodes();
+	hdr.reserved = 0;
+	hdr.time = fem.GetTime().currentTime;
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+
+	for (size_t i = 0; i < mp.size(); i++)
+	{
+		GRMaterialPoint& pt = *mp[i]->ExtractData<GRMaterialPoint>();
+		pt.Commit();
+
+		GRSnapshotPoint rec;
+		rec.r0[0] = mp[i]->m_r0.x; rec.r0[1] = mp[i]->m_r0.y; rec.r0[2] = mp[i]->m_r0.z;
+		rec.Jo = pt.m_Jo;
+		for (int k = 0; k < 3; k++)
+			for (int l = 0; l < 3; l++) rec.Fio[3*k + l] = pt.m_Fio(k,l);
+		rec.svo = pt.m_svo;
+		rec.phic = pt.m_phic;
+		fwrite(&rec, sizeof(rec), 1, fp);
+	}
+
+	const int dof[3] = { fem.GetDOFIndex("x"), fem.GetDOFIndex("y"), fem.GetDOFIndex("z") };
+	for (int i = 0; i < mesh.Nodes(); i++)
+	{
+		FENode& node = mesh.Node(i);
+		const double u[3] = { node.get(dof[0]), node.get(dof[1]), node.get(dof[2]) };
+		fwrite(u, sizeof(double), 3, fp);
+	}
+
+	const bool bok = (ferror(fp) == 0);
+	fclose(fp);
+	if (!bok) { feLogError("mbe_cmm: error writing homeostatic snapshot %s\n", szfile); return false; }
+
+	feLog("mbe_cmm: homeostatic snapshot of %d points written to %s (t = %lg)\n", hdr.npoints, szfile, hdr.time);
+	return true;
+}
+
+// maps a homeostatic snapshot, checks it against the mesh and restores the state of all material
+// points and nodes. The model time is set to the snapshot time, so the analysis starts in the G&R branch.
+bool FEMbeCmm::LoadSnapshot(const char* szfile)
+{
+	FEModel& fem = *GetFEModel();
+	FEMesh& mesh = fem.GetMesh();
+
+	std::vector<FEMaterialPoint*> mp;
+	MaterialPoints(mp);
+
+	const int fd = open(szfile, O_RDONLY);
+	if (fd < 0) { feLogError("mbe_cmm: cannot open homeostatic snapshot %s\n", szfile); return false; }
+
+	struct stat sb;
+	const size_t size = (fstat(fd, &sb) == 0 ? (size_t) sb.st_size : 0);
+	void* pmap = (size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED);
+	close(fd);
+	if (pmap == MAP_FAILED) { feLogError("mbe_cmm: cannot map homeostatic snapshot %s\n", szfile); return false; }
+
+	const char* pd = (const char*) pmap;
+	const GRSnapshotHeader& hdr = *(const GRSnapshotHeader*) pd;
+	const size_t expected = sizeof(GRSnapshotHeader) + mp.size()*sizeof(GRSnapshotPoint) + 3*sizeof(double)*mesh.Nodes();
+
+	// validate the snapshot against this model
+	const char* szerr = nullptr;
+	if      ((size < sizeof(GRSnapshotHeader)) || (memcmp(hdr.magic, GR_SNAPSHOT_MAGIC, 8) != 0)) szerr = "not a homeostatic snapshot";
+	else if (hdr.version != GR_SNAPSHOT_VERSION) szerr = "unsupported version";
+	else if ((hdr.npoints != (int) mp.size()) || (hdr.nnodes != mesh.Nodes())) szerr = "mesh does not match";
+	else if (size != expected) szerr = "unexpected file size";
+	else {
+		const GRSnapshotPoint* rec = (const GRSnapshotPoint*) (pd + sizeof(GRSnapshotHeader));
+		for (size_t i = 0; i < mp.size(); i++) {
+			const vec3d r0(rec[i].r0[0], rec[i].r0[1], rec[i].r0[2]);
+			const vec3d dr = r0 - mp[i]->m_r0;
+			if (dr*dr > 1e-12*(1.0 + r0*r0)) { szerr = "material point positions do not match"; break; }
+		}
+	}
+	if (szerr) {
+		feLogError("mbe_cmm: homeostatic snapshot %s: %s\n", szfile, szerr);
+		munmap(pmap, size);
+		return false;
+	}
+
+	// restore the material points (committed and trial state, the derived data is re-evaluated on first use)
+	const GRSnapshotPoint* rec = (const GRSnapshotPoint*) (pd + sizeof(GRSnapshotHeader));
+	for (size_t i = 0; i < mp.size(); i++)
+	{
+		GRMaterialPoint& pt = *mp[i]->ExtractData<GRMaterialPoint>();
+		pt.m_Jo = rec[i].Jo;
+		for (int k = 0; k < 3; k++)
+			for (int l = 0; l < 3; l++) pt.m_Fio(k,l) = rec[i].Fio[3*k + l];
+		pt.m_svo = rec[i].svo;
+		pt.m_phic = rec[i].phic;
+
+		pt.m_svoT = pt.m_svo;
+		pt.m_phicT = pt.m_phic;
+		pt.m_bpreT = false;
+		pt.InvalidateDerived();
+
+		FEElasticMaterialPoint& ep = *mp[i]->ExtractData<FEElasticMaterialPoint>();
+		ep.m_F = pt.m_Fio.inverse();
+		ep.m_J = pt.m_Jo;
+	}
+
+	// restore the nodal displacements
+	const double* u = (const double*) (pd + sizeof(GRSnapshotHeader) + mp.size()*sizeof(GRSnapshotPoint));
+	const int dof[3] = { fem.GetDOFIndex("x"), fem.GetDOFIndex("y"), fem.GetDOFIndex("z") };
+	for (int i = 0; i < mesh.Nodes(); i++)
+	{
+		FENode& node = mesh.Node(i);
+		for (int k = 0; k < 3; k++) node.set(dof[k], u[3*i + k]);
+		node.m_rt = node.m_r0 + vec3d(u[3*i], u[3*i + 1], u[3*i + 2]);
+		node.m_rp = node.m_rt;
+	}
+
+	const double t = hdr.time;
+	munmap(pmap, size);
+
+	// continue from the snapshot time
+	fem.SetStartTime(t);
+	fem.SetCurrentTime(t);
+
+	feLog("mbe_cmm: homeostatic state of %d points loaded from %s (t = %lg)\n", (int) mp.size(), szfile, t);
+	return true;
+}
+
+// true if the two deformation gradients are identical
+static bool SameDeformation(const mat3d& A, const mat3d& B)
+{
+	for (int i=0; i<3; i++)
+		for (int j=0; j<3; j++)
+			if (A(i,j) != B(i,j)) return false;
+	return true;
+}
+
+// largest change of a component between two deformation gradients
+static double DeformationChange(const mat3d& A, const mat3d& B)
+{
+	double d = 0.0;
+	for (int i=0; i<3; i++)
+		for (int j=0; j<3; j++) d = std::max(d, fabs(A(i,j) - B(i,j)));
+	return d;
+}
+
+// stretches of the local directions of a point (see GRStretch)
+static void Stretches(const mat3d& F, const GRLocalFrame& fr, const GRMaterialPoint& pt, const bool bprestress, GRStretch& st)
+{
+	const vec3d N[3] = {fr.N[0], fr.N[1], fr.N[2]};
+	if (bprestress) {
+		st.l[0] = (F*N[1]).norm();
+		st.l[1] = (F*N[2]).norm();
+		st.l[2] = (F*(N[1]*sinao+N[2]*cosao)).norm();
+		st.l[3] = (F*(N[1]*sinao-N[2]*cosao)).norm();
+	}
+	else {
+		for (int k = 0; k < 3; k++) st.l[k] = (F*(pt.m_Fio*N[k])).norm();
+		st.l[3] = 0.0;
+	}
+}
+
+GRMaterialPoint::GRMaterialPoint(const GRMaterialPoint& pt) : FEMaterialPointData(pt)
+{
+	CopyState(pt);
+	m_rc = (pt.m_rc ? new GRResultCache(*pt.m_rc) : nullptr);
+	m_lt = (pt.m_lt ? new GRLaggedTangent(*pt.m_lt) : nullptr);
+	if (m_pNext) m_pNext = m_pNext->Copy();
 }
 
 FEMaterialPointData* GRMaterialPoint::Copy()
 {
-	GRMaterialPoint* pt = new GRMaterialPoint(*this);
-    if (m_pNext) pt->m_pNext = m_pNext->Copy();
-    return pt;
+	return new GRMaterialPoint(*this);
 }
 
 void GRMaterialPoint::Init()
@@ -32,36 +710,446 @@ void GRMaterialPoint::Init()
 	FEMaterialPointData::Init();
 
 	m_Jo = 1;
-	m_svo = 0;
-	m_smo.zero();
-	m_sco.zero();
 	m_Fio.unit();
-	m_Jh = 1;
-	m_Fih.unit();
+	m_svo = 0;
 
 	m_phic = 0;
-	m_Iemax = 0;
+
+	m_svoT = 0;
+	m_phicT = 0;
+	m_bpreT = false;
+
+	m_t = 0;
+
+	m_JJoP = 1;
+	m_rIrIoP = 1;
+
+	m_stt = 0;
+	m_phim = 0;
+	m_rIrIo = 1;
+	m_act = 0;
+
+	m_ho.state = 0;
+	m_frame.valid = false;
+	if (m_rc) m_rc->state = 0;
+	if (m_lt) m_lt->state = 0;
 }
 
 void GRMaterialPoint::Serialize(DumpStream& ar)
 {
 	FEMaterialPointData::Serialize(ar);
-	ar & m_Jo & m_svo & m_smo & m_sco & m_Fio & m_Jh & m_Fih & m_phic & m_Iemax;
+	ar & m_Jo & m_Fio & m_svo & m_phic;
+	ar & m_svoT & m_phicT & m_bpreT;
+	ar & m_JJoP & m_rIrIoP;
+
+	if (ar.IsLoading()) InvalidateDerived();
+}
+
+// the frozen homeostatic state and the local frame are not stored, they are re-evaluated
+// on first use. neither are cached results, lagged tangents or output (so a retried step
+// starts with fresh tangents)
+void GRMaterialPoint::InvalidateDerived()
+{
+	m_stt = m_phim = m_act = 0;
+	m_rIrIo = 1;
+	m_ho.state = 0;
+	m_frame.valid = false;
+	if (m_rc) m_rc->state = 0;
+	if (m_lt) m_lt->state = 0;
+}
+
+// copies the history, output and derived data (but not the result cache) of another point
+void GRMaterialPoint::CopyState(const GRMaterialPoint& pt)
+{
+	m_Jo    = pt.m_Jo;
+	m_Fio   = pt.m_Fio;
+	m_svo   = pt.m_svo;
+	m_phic  = pt.m_phic;
+
+	m_svoT  = pt.m_svoT;
+	m_phicT = pt.m_phicT;
+	m_bpreT = pt.m_bpreT;
+
+	m_t     = pt.m_t;
+
+	m_JJoP   = pt.m_JJoP;
+	m_rIrIoP = pt.m_rIrIoP;
+
+	m_stt   = pt.m_stt;
+	m_phim  = pt.m_phim;
+	m_rIrIo = pt.m_rIrIo;
+	m_act   = pt.m_act;
+
+	m_ho    = pt.m_ho;
+	m_frame = pt.m_frame;
+}
+
+// commits the trial state of the last converged evaluation and takes the time of the new step, called at
+// the start of each time step. after a failed step FEBio restores both states, so a retry starts from the
+// same committed history (and calls Update again with the reduced time).
+void GRMaterialPoint::Update(const FETimeInfo& timeInfo)
+{
+	Commit();
+
+	m_t = timeInfo.currentTime;
+
+	FEMaterialPointData::Update(timeInfo);
+}
+
+// copies the trial into the committed state (repeated calls have no further effect)
+void GRMaterialPoint::Commit()
+{
+	if (m_bpreT) {
+		// homeostatic state at the end of prestressing, from the converged deformation
+		const mat3d& F = ExtractData<FEElasticMaterialPoint>()->m_F;
+		m_Jo  = F.det();
+		m_Fio = F.inverse();
+		m_svo = m_svoT;
+		m_ho.state = 0;
+	}
+	m_phic = m_phicT;
 }
 
+// the result cache and lagged tangent are allocated here if enabled (and otherwise on first use),
+// so the parallel element loops do not allocate
 FEMaterialPointData* FEMbeCmm::CreateMaterialPointData() 
 { 
-	return new GRMaterialPoint(new FEElasticMaterialPoint); 
+	GRMaterialPoint* pt = new GRMaterialPoint(new FEElasticMaterialPoint);
+	if (m_cache) { pt->m_rc = new GRResultCache; pt->m_rc->state = 0; }
+	if (m_lagTangent) { pt->m_lt = new GRLaggedTangent; pt->m_lt->state = 0; }
+	return pt;
+}
+
+// returns the time-invariant local data of a material point, evaluated on first use
+const GRLocalFrame& FEMbeCmm::LocalFrame(FEMaterialPoint& mp)
+{
+	GRLocalFrame& fr = mp.ExtractData<GRMaterialPoint>()->m_frame;
+	if (fr.valid) return fr;
+
+	const long long tframe = (m_stats ? GRClock() : 0);
+
+	// retrieve material position
+	const vec3d  X = mp.m_r0;
+
+	vec3d N[3];
+	double ro, rIol;
+	if (m_centerline.Empty()) {
+		const vec3d  Xcl = {0.0, imper/100.0*rIo*sin(hwaves*M_PI*X.z/lo), X.z};		// center line
+
+		vec3d NX = {X.x-Xcl.x,X.y-Xcl.y,X.z-Xcl.z};								// radial vector
+
+		ro = sqrt(NX*NX);
+		rIol = rIo;
+
+		NX /= ro;
+
+		// pointwise, consistent with mesh generated with Matlab script <NodesElementsAsy.m>
+		N[2] = {0.0, imper/100.0*rIo*hwaves*M_PI/lo*cos(hwaves*M_PI*X.z/lo), 1.0}; N[2] = N[2]/sqrt(N[2]*N[2]);		// axial = d(Xcl)/d(z)
+		N[1] = {-NX.y, NX.x, NX.z};																					// circumferential
+		N[0] = N[2]^N[1];
+	}
+	else {
+		// nearest point of the discretised center line, radial vector normal to its tangent
+		const GRCenterlinePoint cp = m_centerline.Nearest(X);
+
+		vec3d NX = X - cp.X;
+		NX -= cp.T*(NX*cp.T);
+
+		ro = sqrt(NX*NX);
+		rIol = cp.rIo;
+
+		NX /= ro;
+
+		N[2] = cp.T;					// axial
+		N[1] = cp.T^NX;					// circumferential
+		N[0] = N[2]^N[1];
+	}
+
+	// elementwise, from input file
+	// N[2] = pt.m_Q.col(0); N[1] = pt.m_Q.col(1); N[0] = pt.m_Q.col(2);							// axial, circumferential, radial
+
+	for (int k = 0; k < 3; k++) fr.N[k] = N[k];
+	fr.ro = (gr_real) ro;
+	fr.rIo = (gr_real) rIol;
+	fr.valid = true;
+
+	if (m_stats) Counters().stat.tframe += GRClock() - tframe;
+
+	return fr;
+}
+
+// material evaluations specialized for the regime constants, indexed by
+// ACTIVE + 2*ETA + 4*INFLAM + 8*ALIGN (the last entry is the generic kernel)
+#define GR_KERNEL(n) &FEMbeCmm::StressTangentT<((n)&1)!=0, ((n)&2)!=0, ((n)&4)!=0, ((n)&8)!=0>
+
+static const FEMbeCmm::GRKernel GR_KERNELS[16] = {
+	GR_KERNEL( 0), GR_KERNEL( 1), GR_KERNEL( 2), GR_KERNEL( 3),
+	GR_KERNEL( 4), GR_KERNEL( 5), GR_KERNEL( 6), GR_KERNEL( 7),
+	GR_KERNEL( 8), GR_KERNEL( 9), GR_KERNEL(10), GR_KERNEL(11),
+	GR_KERNEL(12), GR_KERNEL(13), GR_KERNEL(14), GR_KERNEL(15)
+};
+
+void FEMbeCmm::StressTangent(FEMaterialPoint& mp, mat3ds& stress, tens4dmm* tangent)
+{
+	const double eps = std::numeric_limits<double>::epsilon();
+
+	GRMaterialPoint& pt = *mp.ExtractData<GRMaterialPoint>();
+	const mat3d& F = mp.ExtractData<FEElasticMaterialPoint>()->m_F;
+	const double t = pt.m_t;
+	const bool bprestress = (t <= 1.0 + eps);
+	const int nbranch = (bprestress ? 0 : 1);
+
+	GRThreadCounters& tc = Counters();
+
+	// return the cached result if this point was already evaluated for the same F and time
+	if (m_cache) {
+		if (pt.m_rc == nullptr) { pt.m_rc = new GRResultCache; pt.m_rc->state = 0; }
+		const GRResultCache& rc = *pt.m_rc;
+		if ((rc.state == 1) && (rc.t == t) && SameDeformation(rc.F, F)) {
+			stress = rc.s;
+			if (tangent) *tangent = rc.c;
+			tc.ncacheHit++;
+			return;
+		}
+		tc.ncacheMiss++;
+	}
+
+	// with the result cache, a stress request also evaluates the tangent, which FEBio
+	// requests next at the same F (Stress is called before SecantTangent)
+	tens4dmm cs;
+	tens4dmm* ci = tangent;
+	if (m_cache && (ci == nullptr)) ci = &cs;
+
+	// in G&R, reuse the lagged tangent while F stays close to the F it was evaluated at
+	GRLaggedTangent* lt = nullptr;
+	bool blag = false;
+	if (m_lagTangent && !bprestress) {
+		if (pt.m_lt == nullptr) { pt.m_lt = new GRLaggedTangent; pt.m_lt->state = 0; }
+		lt = pt.m_lt;
+		blag = ci && (lt->state & 1) && (DeformationChange(lt->F, F) <= m_lagTol);
+	}
+
+	// at the F and time of the last evaluation (FEBio requests stress and tangent at the same F), the
+	// stress is known, so a stress request or a reused tangent needs no evaluation at all
+	const bool blast = lt && (lt->state & 2) && (lt->ts == t) && SameDeformation(lt->Fs, F);
+	if (blast && ((ci == nullptr) || blag)) {
+		stress = lt->s;
+		if (blag) {
+			*ci = lt->c;
+			tc.nlagReuse++;
+		}
+	}
+	else {
+		const long long tkin = (m_stats ? GRClock() : 0);
+
+		// stretches of the local directions (prestress: N[1], N[2], Np, Nn; G&R: Fio*N[0], Fio*N[1], Fio*N[2])
+		GRStretch st;
+		Stretches(F, LocalFrame(mp), pt, bprestress, st);
+
+		if (m_stats) tc.stat.tkinematics += GRClock() - tkin;
+
+		const long long tkernel = (m_stats ? GRClock() : 0);
+
+		tens4dmm* ck = (blag ? nullptr : ci);
+
+		GRSpectral sd;
+		GRSpectralDecomposition(F, sd);
+
+		// dispatch to the kernel without the terms that vanish for the current regime constants
+		const GRKernel kernel = Kernel(m_eta != 1.0);
+		(this->*kernel)(mp, pt, NominalParams(), sd, st, stress, ck);
+
+		if (blag) {
+			*ci = lt->c;
+			tc.nlagReuse++;
+		}
+		else if (ci && lt) {
+			lt->F = F;
+			lt->c = *ci;
+			lt->state |= 1;
+			tc.nlagEval++;
+		}
+
+		if (lt) {
+			lt->Fs = F;
+			lt->ts = t;
+			lt->s = stress;
+			lt->state |= 2;
+		}
+
+		if (m_stats) {
+			tc.stat.tkernel[nbranch] += GRClock() - tkernel;
+			tc.stat.ncall[nbranch][ck ? 1 : 0]++;
+		}
+	}
+
+	if (m_cache) {
+		GRResultCache& rc = *pt.m_rc;
+		rc.F = F;
+		rc.t = t;
+		rc.s = stress;
+		rc.c = *ci;
+		rc.state = 1;
+	}
+}
+
+// returns the kernel without the terms that vanish for the current regime constants
+// (beta: eta != 1 for any of the evaluated parameter sets)
+FEMbeCmm::GRKernel FEMbeCmm::Kernel(const bool beta) const
+{
+	const int nk = (m_Tmax != 0.0 ? 1 : 0) + (beta ? 2 : 0) + (m_KfKi*m_inflam != 0.0 ? 4 : 0) + (m_aexp != 0.0 ? 8 : 0);
+	return GR_KERNELS[nk];
+}
+
+// the nominal values of the constants that may vary between ensemble members
+GRParams FEMbeCmm::NominalParams() const
+{
+	GRParams par;
+	par.KsKi  = m_KsKi;
+	par.eta   = m_eta;
+	par.cc    = m_cc;
+	par.dc    = m_dc;
+	par.betat = m_betat;
+	par.betaz = m_betaz;
+	par.alpha = alphao;
+	return par;
+}
+
+void FEMbeCmm::StressTangentEnsemble(FEMaterialPoint& mp, const GRParams* par, const int K, mat3ds* stress, tens4dmm* tangent)
+{
+	const double eps = std::numeric_limits<double>::epsilon();
+	const double t = mp.ExtractData<GRMaterialPoint>()->m_t;
+	const bool bprestress = (t <= 1.0 + eps);
+
+	bool beta = false;
+	for (int k = 0; k < K; k++) beta |= (par[k].eta != 1.0);
+	const GRKernel kernel = Kernel(beta);
+
+	GRMaterialPoint& pt = *mp.ExtractData<GRMaterialPoint>();
+	const mat3d& F = mp.ExtractData<FEElasticMaterialPoint>()->m_F;
+	const GRLocalFrame& fr = LocalFrame(mp);
+	const vec3d N[3] = {fr.N[0], fr.N[1], fr.N[2]};
+
+	// shared kinematics
+	GRSpectral sd;
+	GRSpectralDecomposition(F, sd);
+
+	GRStretch st;
+	Stretches(F, fr, pt, bprestress, st);
+
+	// shared polar decomposition of Fo (evaluated into the point, where it is reused by later evaluations)
+	if (!bprestress && (pt.m_ho.state < 1)) {
+		GRSpectral sdo; GRSpectralDecomposition(pt.m_Fio.inverse(), sdo);
+		pt.m_ho.Uo = sdo.U;
+		pt.m_ho.state = 1;
+	}
+
+	for (int k = 0; k < K; k++)
+	{
+		// members work on a copy of the history; the frozen homeostatic stresses are re-derived from Uo
+		GRMaterialPoint pk(nullptr);
+		pk.CopyState(pt);
+		pk.m_ho.state = std::min(pt.m_ho.state, 1);
+
+		// the prestress stretches of the diagonal fibers depend on their original orientation
+		GRStretch stk = st;
+		if (bprestress && (par[k].alpha != alphao)) {
+			const double a = par[k].alpha;
+			stk.l[2] = (F*(N[1]*sin(a) + N[2]*cos(a))).norm();
+			stk.l[3] = (F*(N[1]*sin(a) - N[2]*cos(a))).norm();
+		}
+
+		(this->*kernel)(mp, pk, par[k], sd, stk, stress[k], (tangent ? tangent + k : nullptr));
+	}
+}
+
+// Solves the mass balance phieo + phimo*(J/Jo*phic/phico)^eta + J/Jo*phic - J/Jo = 0 for the collagen
+// mass fraction phic. On input phic is the starting guess (last converged value), on output the solution.
+// nit and nbisect return the number of iterations and of bisection fallbacks.
+// Returns false if the maximum number of iterations was reached.
+template <bool ETA>
+static bool SolvePhic(const double JJo, const double phieo, const double phimo, const double phico, const double eta, const int maxit, double& phic, int& nit, int& nbisect)
+{
+	nit = nbisect = 0;
+
+	// eta = 1: the residue is linear in phic
+	if (!ETA) {
+		phic = (JJo-phieo)/(JJo*(1.0+phimo/phico));
+		return true;
+	}
+
+	const double tol = sqrt(std::numeric_limits<double>::epsilon());
+
+	// the residue increases monotonically with phic and changes sign in [0, 1-phieo*Jo/J]
+	double lo = 0.0;
+	double hi = 1.0-phieo/JJo;
+	if (hi <= lo) { phic = 0.0; return false; }
+
+	if (!(phic > lo && phic < hi)) phic = 0.5*(lo+hi);
+
+	for (int i=0; i<maxit; i++, nit++) {
+		const double x    = JJo*phic/phico;
+		const double xe1  = gr_pow(x,eta-1.0);											// x^eta = x*x^(eta-1)
+		const double Rphi = phieo+phimo*x*xe1+JJo*phic-JJo;								// residue
+		const double dRdc = JJo*(1.0+phimo/phico*eta*xe1);								// tangent d(R)/d(phic)
+
+		// converge phase
+		if (fabs(Rphi) <= tol) { phic = phic-Rphi/dRdc; return true; }
+
+		// shrink the bracket and fall back to bisection if the Newton update leaves it
+		if (Rphi > 0.0) hi = phic; else lo = phic;
+		phic = phic-Rphi/dRdc;
+		if (!(phic > lo && phic < hi)) { phic = 0.5*(lo+hi); nbisect++; }
+	}
+
+	return false;
+}
+
+void GRSpectralDecomposition(const mat3d& F, GRSpectral& sd)
+{
+	sd.C = (F.transpose()*F).sym();
+
+	double lc[3];
+	sd.C.eigen2(lc, sd.v);
+
+	// make sure the principal directions are orthonormal, also for repeated eigenvalues
+	sd.v[0].unit();
+	sd.v[1] -= sd.v[0]*(sd.v[0]*sd.v[1]);
+	if (sd.v[1].unit() < 1.0e-8) {
+		// any direction perpendicular to v[0]
+		sd.v[1] = (fabs(sd.v[0].x) < 0.9 ? vec3d(1,0,0) : vec3d(0,1,0));
+		sd.v[1] -= sd.v[0]*(sd.v[0]*sd.v[1]);
+		sd.v[1].unit();
+	}
+	sd.v[2] = sd.v[0]^sd.v[1];
+
+	sd.Ci.zero(); sd.U.zero(); sd.Ui.zero();
+	for (int i=0; i<3; i++) {
+		const mat3ds Ni = dyad(sd.v[i]);
+		sd.lam[i] = sqrt(lc[i]);
+		sd.Ci += Ni/lc[i];
+		sd.U  += Ni*sd.lam[i];
+		sd.Ui += Ni/sd.lam[i];
+	}
+
+	sd.R = F*sd.Ui;
 }
 
-void FEMbeCmm::StressTangent(FEMaterialPoint& mp, mat3ds& stress, tens4dmm& tangent)
-{		
+// index of the component (i,j) of a symmetric second-order tensor in Voigt order (xx, yy, zz, xy, yz, xz)
+static const int VOIGT[3][3] = {{0, 3, 5}, {3, 1, 4}, {5, 4, 2}};
+
+// (x)^(eta-1), resolved at compile time for eta = 1
+template <bool ETA> static inline double pow_eta1(double x, double eta) { return (ETA ? gr_pow(x, eta-1.0) : 1.0); }
+
+template <bool ACTIVE, bool ETA, bool INFLAM, bool ALIGN>
+void FEMbeCmm::StressTangentT(FEMaterialPoint& mp, GRMaterialPoint& pt, const GRParams& par, const GRSpectral& sd, const GRStretch& st, mat3ds& stress, tens4dmm* tangent)
+{
 	// The FEMaterialPoint classes are stored in a linked list. The specific material
 	// point data needed by this function can be accessed using the ExtractData member.
 	// In this case, we want to FEElasticMaterialPoint data since it stores the deformation
-	// information that is needed to evaluate the stress.
+	// information that is needed to evaluate the stress. The history is read from and
+	// written to pt (the point's own GRMaterialPoint, or a copy for ensemble evaluations).
 	FEElasticMaterialPoint& et = *mp.ExtractData<FEElasticMaterialPoint>();
-	GRMaterialPoint& pt = *mp.ExtractData<GRMaterialPoint>();
 
 	// We'll need the deformation gradient and its determinant in this function.
 	// Note that we don't take the determinant of F directly (using mat3d::det)
@@ -72,49 +1160,18 @@ void FEMbeCmm::StressTangent(FEMaterialPoint& mp, mat3ds& stress, tens4dmm& tang
 	const double eps = std::numeric_limits<double>::epsilon();
 
 	// get current and end times
-	const double t = GetFEModel()->GetTime().currentTime;
+	const double t = pt.m_t;
 
 	const double endtime = 11.0;							// 11.0 | 31.0-32.0 (TEVG)
 	const double partialtime = endtime;			// partialtime <= endtime | 10.0 | 10.4 (for TI calculation)
 	const double sgr = min(t,partialtime);		// min(t,partialtime) | min(t,9.0)
 
-	// retrieve material position
-	const vec3d  X = mp.m_r0;
-
-	const double imper = 0.00;					// imper > 0 for TORTUOSITY (see Matlab script <NodesElementsAsy.m>) | 0.00 | 20.0
-	const double rIo = 0.6468;					// 0.6468 | 0.5678
-	const double hwaves = 2.0;
-	const double lo = 30.0;
-	const vec3d  Xcl = {0.0, imper/100.0*rIo*sin(hwaves*M_PI*X.z/lo), X.z};		// center line
-
-	vec3d NX = {X.x-Xcl.x,X.y-Xcl.y,X.z-Xcl.z};								// radial vector
-
-	const double ro = sqrt(NX*NX);
-
-	NX /= ro;
-
-	// retrieve local element basis directions
-	vec3d N[3];
-
-	// pointwise, consistent with mesh generated with Matlab script <NodesElementsAsy.m>
-	N[2] = {0.0, imper/100.0*rIo*hwaves*M_PI/lo*cos(hwaves*M_PI*X.z/lo), 1.0}; N[2] = N[2]/sqrt(N[2]*N[2]);		// axial = d(Xcl)/d(z)
-	N[1] = {-NX.y, NX.x, NX.z};																					// circumferential
-	N[0] = N[2]^N[1];
-
-	// elementwise, from input file
-	// N[2] = pt.m_Q.col(0); N[1] = pt.m_Q.col(1); N[0] = pt.m_Q.col(2);							// axial, circumferential, radial
-
-	const double phieo = 0.34;								// 0.34 (CMAME | KNOCKOUTS) | 1.00 (TEVG) | 1.0/3.0 (TEVG)
 	const double phimo = 0.5*(1.0-phieo);
 	const double phico = 0.5*(1.0-phieo);
 
-	const double eta = 1.0;									// 1.0 | 1.0/3.0 (for uniform cases) | 0.714
+	const double eta = par.eta;
 
-	const double mu = 89.71;
-	const double Get = 1.90;
-	const double Gez = 1.62;
-
-	double alpha = 0.522;								// original orientation of diagonal collagen | 0.522 (CMAME | KNOCKOUTS) | 0.8713 (TEVG)
+	const double alpha = par.alpha;					// orientation of diagonal collagen
 
 	// original homeostatic parameters (adaptive)
 
@@ -122,76 +1179,67 @@ void FEMbeCmm::StressTangent(FEMaterialPoint& mp, mat3ds& stress, tens4dmm& tang
 	const double cm = 261.4;									// 261.4 (CMAME | KNOCKOUTS) | 46.61 (TEVG)
 	const double dm = 0.24;
 	const double Gm = 1.20;
-	const double cc = 234.9;									// 234.9 (CMAME | KNOCKOUTS) | 328.475 (TEVG)
-	const double dc = 4.08;
+	const double cc = par.cc;
+	const double dc = par.dc;
 	const double Gc = 1.25;
 
 	// orientation fractions for collagen
-	const double betat = 0.056;
-	const double betaz = 0.067;
+	const double betat = par.betat;
+	const double betaz = par.betaz;
 	const double betad = 0.5*(1.0 - betat - betaz);
 
-	vec3d  Np = N[1]*sin(alpha)+N[2]*cos(alpha);		// original diagonal fiber direction
-	vec3d  Nn = N[1]*sin(alpha)-N[2]*cos(alpha);		// idem for symmetric
-
 	// active
-	const double Tmax = 250.0 * 0.0;							// 250.0 | 50.0 | 150.0 (for uniform cases, except for contractility -> 250)
+	const double Tmax = m_Tmax;
 	const double lamM = 1.1;
 	const double lam0 = 0.4;
-	const double CB = sqrt(log(2.0));							// such that (1-exp(-CB^2)) = 0.5
-	const double CS = 0.5*CB * 1.0;							// such that (1-exp( -C^2)) = 0.0 for lt = 1/(1+CB/CS)^(1/3) = 0.7 and (1-exp(-C^2)) = 0.75 for lt = 2.0
+	const double aL = 1.0-((lamM-1.0)/(lamM-lam0))*((lamM-1.0)/(lamM-lam0));	// length dependence of the active stress
 
-	const double KsKi = 0.35;
-	const double EPS  = 1.0+(1.0-1.0)*(sgr-1.0)/(endtime-1.0);
+	const double KsKi = par.KsKi;
+	const double EPS  = 1.0+(m_EPS-1.0)*(sgr-1.0)/(endtime-1.0);
 
-	const double KfKi   = 1.0;
-	const double inflam = 0.0*(sgr-1.0)/(endtime-1.0);
+	const double KfKi   = m_KfKi;
+	const double inflam = (INFLAM ? m_inflam*(sgr-1.0)/(endtime-1.0) : 0.0);
 
-	const double aexp = 1.0;									// 1.0 (KNOCKOUTS | TEVG) | 0.0 (CMAME | TORTUOSITY)
+	const double aexp = m_aexp;
 
-	const double delta = 0.0;
+	const double delta = m_delta;
 
-	// compute U from polar decomposition of deformation gradient tensor
-	mat3ds U; mat3d R; F.right_polar(R,U);
+	// time-invariant local basis, fiber directions and elastin stress (evaluated once per point)
+	const GRLocalFrame& fr = LocalFrame(mp);
 
-	double eigenval[3]; vec3d eigenvec[3];
-	U.eigen2(eigenval,eigenvec);
+	// retrieve local element basis directions
+	const vec3d  N[3] = {fr.N[0], fr.N[1], fr.N[2]};
+	const double ro = fr.ro;
+	const double rIo = fr.rIo;
 
-	// right Cauchy-Green tensor and its inverse
-	const mat3ds C = et.RightCauchyGreen();
-	const mat3ds Ci = C.inverse();
+	// original diagonal fiber directions
+	const double sina = (alpha != alphao ? sin(alpha) : sinao);
+	const double cosa = (alpha != alphao ? cos(alpha) : cosao);
+	vec3d  Np = N[1]*sina+N[2]*cosa;
+	vec3d  Nn = N[1]*sina-N[2]*cosa;
 
-	// Ge from spectral decomposition
-	const mat3ds Ge = 1.0/Get/Gez*dyad(N[0]) + Get*dyad(N[1]) + Gez*dyad(N[2]);
-	
-	// stress for elastin
-	const mat3ds Se = (phieo*mu*Ge*Ge).sym();						// phieo*Ge*Sehat*Ge = phieo*Ge*(mu*I)*Ge
+	// stress for elastin, phieo*Ge*Sehat*Ge = phieo*Ge*(mu*I)*Ge with Ge = 1/Get/Gez*N[0]xN[0] + Get*N[1]xN[1] + Gez*N[2]xN[2]
+	const mat3ds Se = phieo*mu*(dyad(N[0])/(Get*Gez*Get*Gez) + dyad(N[1])*(Get*Get) + dyad(N[2])*(Gez*Gez));
+
+	// right Cauchy-Green tensor, its inverse and the polar decomposition of F (from one spectral decomposition)
+	const mat3ds& C  = sd.C;
+	const mat3ds& Ci = sd.Ci;
+	const mat3d&  R  = sd.R;
 
 	// computation of the second Piola-Kirchhoff stress
 	mat3ds S;
 
-	// define identity tensor and some useful dyadic products of the identity tensor
-	const mat3dd  I(1.0);
-	const tens4ds IxI = dyad1s(I);
-	const tens4ds IoI = dyad4s(I);
-	const tens4dmm IxIss = tens4dmm(IxI);							// IxI in tens4dmm form
-	const tens4dmm IoIss = tens4dmm(IoI);							// IoI in tens4dmm form
-
-	// spatial moduli for elastin
-	tens4ds ce(0.0);								// phieo/J*(FcF:GecGe:Cehat:GecGe:FTcFT) = phieo/J*(FcF:GecGe:0:GecGe:FTcFT)
-
-	// computation of spatial moduli
+	// computation of spatial moduli (only if a tangent is requested)
 	tens4dmm css;
-	mat3ds sfpro;
 	if (t <= 1.0 + eps) {
 		// compute stress
 		const double Jdep = 0.9999;
 		const double lm = 1.0e3*mu;
 		
-		const double lt = (F*N[1]).norm();
-		const double lz = (F*N[2]).norm();
-		const double lp = (F*Np).norm();
-		const double ln = (F*Nn).norm();
+		const double lt = st.l[0];							// (F*N[1]).norm()
+		const double lz = st.l[1];							// (F*N[2]).norm()
+		const double lp = st.l[2];							// (F*Np).norm()
+		const double ln = st.l[3];							// (F*Nn).norm()
 		
 		const double lmt2 = (Gm*lt)*(Gm*lt);
 		const double lct2 = (Gc*lt)*(Gc*lt);
@@ -199,256 +1247,343 @@ void FEMbeCmm::StressTangent(FEMaterialPoint& mp, mat3ds& stress, tens4dmm& tang
 		const double lcp2 = (Gc*lp)*(Gc*lp);
 		const double lcn2 = (Gc*ln)*(Gc*ln);
 		
+		// exponents of the fiber laws and their exponentials (vectorized), shared by stress and tangent
+		const double q[5] = {dm*(lmt2-1.0)*(lmt2-1.0), dc*(lct2-1.0)*(lct2-1.0), dc*(lcz2-1.0)*(lcz2-1.0), dc*(lcp2-1.0)*(lcp2-1.0), dc*(lcn2-1.0)*(lcn2-1.0)};
+		double eq[5];
+		gr_exp(q, eq, 5);
+
+		const double lJ = gr_log(Jdep*J);
+
 		// passive
-		const mat3ds Sm = (cm*(lmt2-1.0)*exp(dm*(lmt2-1.0)*(lmt2-1.0))*(Gm*Gm)*dyad(N[1]));
-		const mat3ds Sc =	(cc*(lct2-1.0)*exp(dc*(lct2-1.0)*(lct2-1.0))*(Gc*Gc)*dyad(N[1])*betat +
-							 cc*(lcz2-1.0)*exp(dc*(lcz2-1.0)*(lcz2-1.0))*(Gc*Gc)*dyad(N[2])*betaz +
-					 	 	 cc*(lcp2-1.0)*exp(dc*(lcp2-1.0)*(lcp2-1.0))*(Gc*Gc)*dyad( Np )*betad +
-							 cc*(lcn2-1.0)*exp(dc*(lcn2-1.0)*(lcn2-1.0))*(Gc*Gc)*dyad( Nn )*betad );
+		const mat3ds Sm = (cm*(lmt2-1.0)*eq[0]*(Gm*Gm)*dyad(N[1]));
+		const mat3ds Sc =	(cc*(lct2-1.0)*eq[1]*(Gc*Gc)*dyad(N[1])*betat +
+							 cc*(lcz2-1.0)*eq[2]*(Gc*Gc)*dyad(N[2])*betaz +
+					 	 	 cc*(lcp2-1.0)*eq[3]*(Gc*Gc)*dyad( Np )*betad +
+							 cc*(lcn2-1.0)*eq[4]*(Gc*Gc)*dyad( Nn )*betad );
 
 		// active
-		const mat3ds Sa = Tmax*(1.0-exp(-CB*CB))*(1.0-pow((lamM-1.0)/(lamM-lam0),2))*(lt*lt)*dyad(N[1]);
+		mat3ds Sa; Sa.zero();
+		if (ACTIVE) Sa = Tmax*aCB*aL*(lt*lt)*dyad(N[1]);
 		
-		const mat3ds Sx = Se + phimo * Sm + phico * Sc + phimo * Sa;
+		const mat3ds Sx = (ACTIVE ? Se + phimo * Sm + phico * Sc + phimo * Sa : Se + phimo * Sm + phico * Sc);
 		
-		S = Sx + Ci*lm*log(Jdep*J);
+		S = Sx + Ci*lm*lJ;
 		
-		mat3d u(U);
-		
-		pt.m_Jo    = J;
-		pt.m_svo   = 1.0/3.0/J*S.dotdot(C);
-		pt.m_smo   = 1.0/J*(u*(Sm*u)).sym();
-		pt.m_sco   = 1.0/J*(u*(Sc*u)).sym();
-		pt.m_Fio   = F.inverse();
-		pt.m_Jh    = pt.m_Jo;
-		pt.m_Fih   = pt.m_Fio;
-		pt.m_phic  = phico;
-
-		// compute tangent
-		const mat3ds tent = dyad(F*N[1]);
-		const mat3ds tenz = dyad(F*N[2]);
-		const mat3ds tenp = dyad(F*Np);
-		const mat3ds tenn = dyad(F*Nn);
+		// trial history, committed in GRMaterialPoint::Update (Jo and Fio are taken from the converged F)
+		pt.m_svoT  = 1.0/3.0/J*S.dotdot(C);
+		pt.m_phicT = phico;
+		pt.m_bpreT = true;
 
-		// passive
-		tens4ds cf = phimo*(2.0*cm*(1.0+2.0*dm*(lmt2-1.0)*(lmt2-1.0))*exp(dm*(lmt2-1.0)*(lmt2-1.0))*pow(Gm,4)*dyad1s(tent))      +
-					 phico*(2.0*cc*(1.0+2.0*dc*(lct2-1.0)*(lct2-1.0))*exp(dc*(lct2-1.0)*(lct2-1.0))*pow(Gc,4)*dyad1s(tent)*betat +
-							2.0*cc*(1.0+2.0*dc*(lcz2-1.0)*(lcz2-1.0))*exp(dc*(lcz2-1.0)*(lcz2-1.0))*pow(Gc,4)*dyad1s(tenz)*betaz +
-							2.0*cc*(1.0+2.0*dc*(lcp2-1.0)*(lcp2-1.0))*exp(dc*(lcp2-1.0)*(lcp2-1.0))*pow(Gc,4)*dyad1s(tenp)*betad +
-							2.0*cc*(1.0+2.0*dc*(lcn2-1.0)*(lcn2-1.0))*exp(dc*(lcn2-1.0)*(lcn2-1.0))*pow(Gc,4)*dyad1s(tenn)*betad);
+		pt.m_phim  = (gr_real) phimo;
+		pt.m_rIrIo = 1;
+		pt.m_act   = (ACTIVE ? 1 : 0);
 
-		// active
-		tens4ds ca = phimo*2.0*Tmax*(1.0-exp(-CB*CB))*(1.0-pow((lamM-1.0)/(lamM-lam0),2))*dyad1s(tent);
+		if (tangent) {
+			// spatial moduli for elastin vanish: phieo/J*(FcF:GecGe:Cehat:GecGe:FTcFT) = phieo/J*(FcF:GecGe:0:GecGe:FTcFT)
+
+			// compute tangent
+			const GRVoigtVec tent = dyad(F*N[1]);
+			const GRVoigtVec tenz = dyad(F*N[2]);
+			const GRVoigtVec tenp = dyad(F*Np);
+			const GRVoigtVec tenn = dyad(F*Nn);
+
+			// passive (the smc, circumferential collagen and active terms share tent x tent)
+			const double Gm4 = (Gm*Gm)*(Gm*Gm);
+			const double Gc4 = (Gc*Gc)*(Gc*Gc);
 
-		cf /= J; ca /= J;
+			double kt = phimo*2.0*cm*(1.0+2.0*q[0])*eq[0]*Gm4 +
+						phico*2.0*cc*(1.0+2.0*q[1])*eq[1]*Gc4*betat;
 
-		tens4ds c = ce + cf + ca;
+			// active
+			if (ACTIVE) kt += phimo*2.0*Tmax*aCB*aL;
 
-		c += lm/J*(IxI-2.0*log(Jdep*J)*IoI);
+			GRVoigt c;
+			c.Dyad(kt/J, tent);
+			c.Dyad(phico*2.0*cc*(1.0+2.0*q[2])*eq[2]*Gc4*betaz/J, tenz);
+			c.Dyad(phico*2.0*cc*(1.0+2.0*q[3])*eq[3]*Gc4*betad/J, tenp);
+			c.Dyad(phico*2.0*cc*(1.0+2.0*q[4])*eq[4]*Gc4*betad/J, tenn);
 
-		css = tens4dmm(c);		// c in tens4dmm form
+			// lm/J*(IxI-2.0*log(Jdep*J)*IoI)
+			c.IxI(lm/J);
+			c.IoI(-2.0*lm/J*lJ);
+
+			css = c.Tens4dmm();
+		}
 	}
 	else if (t <= partialtime + eps) {
 		// compute stress
 		const double    Jo = pt.m_Jo;
 		const double   svo = pt.m_svo;
-		mat3ds        &smo = pt.m_smo;
-		mat3ds        &sco = pt.m_sco;
 		const mat3d    Fio = pt.m_Fio;
-		double       &phic = pt.m_phic;
+		double        phic = pt.m_phic;
 		
-		phic = phico;																// initial guess
-		double dRdc = J/Jo*(1.0+phimo/phico*eta*pow(J/Jo*phic/phico,eta-1.0));		// initial tangent d(R)/d(phic)
-		double Rphi = phieo+phimo*pow(J/Jo*phic/phico,eta)+J/Jo*phic-J/Jo;			// initial residue
-		do {																		// local iterations to obtain phic
-			phic = phic-Rphi/dRdc;													// phic
-			dRdc = J/Jo*(1.0+phimo/phico*eta*pow(J/Jo*phic/phico,eta-1.0));			// tangent
-			Rphi = phieo+phimo*pow(J/Jo*phic/phico,eta)+J/Jo*phic-J/Jo;				// update residue
-		} while (abs(Rphi) > sqrt(eps));											// && abs(Rphi/Rphi0) > sqrt(eps) && j<10
-		phic = phic-Rphi/dRdc;														// converge phase -> phic (updated in material point memory)
-
-		const double phim = phimo/(J/Jo)*pow(J/Jo*phic/phico,eta);	// phim from <J*phim/phimo=(J*phic/phico)^eta>
-		
-		// recompute remodeled original stresses for smc and collagen (from remodeled natural configurations)
+		// local solve for phic, warm started from the last converged value
+		const long long tphic = (m_stats ? GRClock() : 0);
+		int nit, nbisect;
+		if (!SolvePhic<ETA>(J/Jo, phieo, phimo, phico, eta, m_phicMaxIter, phic, nit, nbisect)) Counters().nphicFail++;
+		if (m_stats) {
+			GRStatistics& st = Counters().stat;
+			st.nphicIter[std::min(nit, GR_PHIC_BINS - 1)]++;
+			st.nphicBisect += nbisect;
+			st.tphic += GRClock() - tphic;
+		}
+		pt.m_phicT = phic;
+		pt.m_bpreT = false;
 
-		const double lto = (Fio.inverse()*N[1]).norm();
-		const double lzo = (Fio.inverse()*N[2]).norm();
-		const double lpo = (Fio.inverse()*Np).norm();					// original referential stretch for deposition stretch calculation
-		const double lno = (Fio.inverse()*Nn).norm();					// idem for symmetric
-		
-		const double lmt2 = (Gm*lto)*(Gm*lto);
-		const double lct2 = (Gc*lto)*(Gc*lto);
-		const double lcz2 = (Gc*lzo)*(Gc*lzo);
-		const double lcp2 = (Gc*lpo)*(Gc*lpo);						// deposition stretch calculation (computational purposes)
-		const double lcn2 = (Gc*lno)*(Gc*lno);						// idem for symmetric
-
-		const double lr = (F*(Fio*N[0])).norm();						// lr -> 1 for F -> Fo
-		const double lt = (F*(Fio*N[1])).norm();						// lt -> 1 for F -> Fo
-		const double lz = (F*(Fio*N[2])).norm();						// lz -> 1 for F -> Fo
-
-		alpha = atan(tan(alpha)*pow(lt/lz,aexp));				// update alpha
-		Np = N[1]*sin(alpha)+N[2]*cos(alpha);					// update diagonal fiber vector
-		Nn = N[1]*sin(alpha)-N[2]*cos(alpha);					// idem for symmetric
+		const double xe1  = pow_eta1<ETA>(J/Jo*phic/phico,eta);				// (J/Jo*phic/phico)^(eta-1)
+		const double phim = phimo/(J/Jo)*(J/Jo*phic/phico)*xe1;				// phim from <J*phim/phimo=(J*phic/phico)^eta>
 		
-		// passive
-		const mat3ds Smo = (cm*(lmt2-1.0)*exp(dm*(lmt2-1.0)*(lmt2-1.0))*(Gm*Gm)*dyad(N[1]));
-		const mat3ds Sco = (cc*(lct2-1.0)*exp(dc*(lct2-1.0)*(lct2-1.0))*(Gc*Gc)*dyad(N[1])*betat +
-					  cc*(lcz2-1.0)*exp(dc*(lcz2-1.0)*(lcz2-1.0))*(Gc*Gc)*dyad(N[2])*betaz +
-					  cc*(lcp2-1.0)*exp(dc*(lcp2-1.0)*(lcp2-1.0))*(Gc*Gc)*dyad( Np )*betad +
-					  cc*(lcn2-1.0)*exp(dc*(lcn2-1.0)*(lcn2-1.0))*(Gc*Gc)*dyad( Nn )*betad );
+		// original stresses for smc and collagen (from remodeled natural configurations), frozen on the first G&R evaluation.
+		// without reorientation, the diagonal families are frozen into sco as well
+		GRHomeostatic& ho = pt.m_ho;
+		if ((ho.state < 2) || (ho.align != ALIGN)) {
+			// Uo from polar decomposition (independent of the material constants)
+			if (ho.state < 1) {
+				GRSpectral sdo; GRSpectralDecomposition(pt.m_Fio.inverse(), sdo);
+				ho.Uo = sdo.U;
+				ho.state = 1;
+			}
+			const mat3ds Uo = ho.Uo;
+			const mat3d  uo(Uo);
+
+			// |Fo*N| = |Ro*Uo*N| = |Uo*N|
+			const double lto = (Uo*N[1]).norm();
+			const double lzo = (Uo*N[2]).norm();
+			const double lpo = (Uo*Np).norm();					// original referential stretch for deposition stretch calculation
+			const double lno = (Uo*Nn).norm();					// idem for symmetric
+
+			const double lmt2 = (Gm*lto)*(Gm*lto);
+			const double lct2 = (Gc*lto)*(Gc*lto);
+			const double lcz2 = (Gc*lzo)*(Gc*lzo);
+			const double lcp2 = (Gc*lpo)*(Gc*lpo);						// deposition stretch calculation (computational purposes)
+			const double lcn2 = (Gc*lno)*(Gc*lno);						// idem for symmetric
+
+			// constant stress magnitudes of the diagonal families at constituent level
+			const double scphato = cc*(lcp2-1.0)*exp(dc*(lcp2-1.0)*(lcp2-1.0))*(Gc*Gc);
+			const double scnhato = cc*(lcn2-1.0)*exp(dc*(lcn2-1.0)*(lcn2-1.0))*(Gc*Gc);
+
+			// passive
+			const mat3ds Smo = (cm*(lmt2-1.0)*exp(dm*(lmt2-1.0)*(lmt2-1.0))*(Gm*Gm)*dyad(N[1]));
+			const mat3ds Sco = (cc*(lct2-1.0)*exp(dc*(lct2-1.0)*(lct2-1.0))*(Gc*Gc)*dyad(N[1])*betat +
+						  cc*(lcz2-1.0)*exp(dc*(lcz2-1.0)*(lcz2-1.0))*(Gc*Gc)*dyad(N[2])*betaz);
+			const mat3ds Sdo = (scphato*dyad( Np )*betad + scnhato*dyad( Nn )*betad);
+
+			// active, per unit Tmax
+			const mat3ds Sao = aCB*aL*(lto*lto)*dyad(N[1]);
+
+			ho.smo = 1.0/Jo*(uo*(Smo*uo)).sym();
+			ho.sco = 1.0/Jo*(uo*((ALIGN ? Sco : Sco + Sdo)*uo)).sym();
+			ho.sao = 1.0/Jo*(uo*(Sao*uo)).sym();
+			ho.scphato = (gr_real) scphato;
+			ho.scnhato = (gr_real) scnhato;
+			ho.state = 2;
+			ho.align = ALIGN;
+		}
 
-		// active
-		const mat3ds Sao = Tmax*(1.0-exp(-CB*CB))*(1.0-pow((lamM-1.0)/(lamM-lam0),2))*(lto*lto)*dyad(N[1]);
-		
-		mat3ds Uo; mat3d Ro; (Fio.inverse()).right_polar(Ro,Uo);	// Uo from polar decomposition
-		mat3d  uo(Uo);
-		
-		smo = 1.0/Jo*(uo*(Smo*uo)).sym();
-		sco = 1.0/Jo*(uo*(Sco*uo)).sym();
+		const double lr = st.l[0];						// (F*(Fio*N[0])).norm(), lr -> 1 for F -> Fo
+		const double lt = st.l[1];						// (F*(Fio*N[1])).norm(), lt -> 1 for F -> Fo
+		const double lz = st.l[2];						// (F*(Fio*N[2])).norm(), lz -> 1 for F -> Fo
+
+		const double scphato = ho.scphato;
+		const double scnhato = ho.scnhato;
+		const mat3ds smo = ho.smo;
+		mat3ds sco = ho.sco;
+
+		// tan, cos and sin of the updated alpha = atan(tan(alpha)*(lt/lz)^aexp)
+		double ta = 0.0, ca = 0.0;
+		if (ALIGN) {
+			ta = tan(alpha)*gr_pow(lt/lz,aexp);
+			ca = 1.0/sqrt(1.0+ta*ta);
+			Np = N[1]*(ta*ca)+N[2]*ca;							// update diagonal fiber vector
+			Nn = N[1]*(ta*ca)-N[2]*ca;							// idem for symmetric
+
+			// diagonal families in the current orientation
+			const mat3d uo(ho.Uo);
+			const mat3ds Sdo = (scphato*dyad( Np )*betad + scnhato*dyad( Nn )*betad);
+			sco += 1.0/Jo*(uo*(Sdo*uo)).sym();
+		}
 
-		const mat3ds sao = 1.0/Jo*(uo*(Sao*uo)).sym();
+		// active
+		mat3ds sao; sao.zero();
+		if (ACTIVE) sao = Tmax*ho.sao;
 
 		// compute current stresses
 		
 		double rIrIo = ro/rIo*lt-(ro-rIo)/rIo*lr;				// rIrIo -> rIorIo = 1 for F -> Fo
+		const double rIrIo3 = 1.0/(rIrIo*rIrIo*rIrIo);			// rIrIo^-3
+		const double rIrIo4 = rIrIo3/rIrIo;						// rIrIo^-4
 
 		mat3ds sNm = phim*smo;									// phim*smhato = phim*smo
 		mat3ds sNc = phic*sco;									// phic*schato = phic*sco
 
 		const mat3ds sNf = sNm + sNc;
 
-		const double Cratio = CB-CS*(EPS*pow(rIrIo,-3)-1.0);
+		const double Cratio = CB-CS*(EPS*rIrIo3-1.0);
+		const double eC = (ACTIVE ? gr_exp(-Cratio*Cratio) : 0.0);
 		mat3ds sNa; sNa.zero();
-		if (Cratio>0) sNa = phim*(1.0-exp(-Cratio*Cratio))/(1.0-exp(-CB*CB))*sao;
+		const double ract = (ACTIVE && Cratio>0 ? (1.0-eC)/aCB : 0.0);		// active tone relative to homeostatic
+		if (ACTIVE && Cratio>0) sNa = phim*ract*sao;
+
+		pt.m_phim  = (gr_real) phim;
+		pt.m_rIrIo = (gr_real) rIrIo;
+		pt.m_act   = (gr_real) ract;
 
-		const mat3ds Ui = U.inverse();            					// inverse of U
-		const mat3d  ui(Ui);
+		const mat3ds& Ui = sd.Ui;            					// inverse of U
+		const mat3d   ui(Ui);
 
 		const mat3ds Sf = J*(ui*sNf*ui).sym();						// J*Ui*sNf*Ui
-		const mat3ds Sa = J*(ui*sNa*ui).sym();						// J*Ui*sNa*Ui
+		mat3ds Sa; Sa.zero();
+		if (ACTIVE) Sa = J*(ui*sNa*ui).sym();						// J*Ui*sNa*Ui
 		
-		const mat3ds Sx = Se + Sf + Sa;
+		const mat3ds Sx = (ACTIVE ? Se + Sf + Sa : Se + Sf);
 
-		const double p = 1.0/3.0/J*Sx.dotdot(C) - svo/(1.0-delta)*(1.0+KsKi*(EPS*pow(rIrIo,-3)-1.0)-KfKi*inflam);		// Ups = 1 -> p
+		const double p = 1.0/3.0/J*Sx.dotdot(C) - svo/(1.0-delta)*(1.0+KsKi*(EPS*rIrIo3-1.0)-(INFLAM ? KfKi*inflam : 0.0));		// Ups = 1 -> p
 		
 		S = Sx - J*p*Ci;
-		
-		pt.m_Jh  = J;
-		pt.m_Fih = F.inverse();
-
-		//compute tangent
-
-		// compute current stresses
-		sNm = smo;										// phim*smhato = phim*smo
-		sNc = sco;										// phic*schato = phic*sco
-
-		// 2nd P-K stresses
-		const mat3ds Sm = J*(ui*sNm*ui).sym();						// J*Ui*sNm*Ui
-		const mat3ds Sc = J*(ui*sNc*ui).sym();						// J*Ui*sNc*Ui
-
-		// associated Cauchy stresses
-		const mat3ds sm = 1.0/J*(F*(Sm*F.transpose())).sym();
-		const mat3ds sc = 1.0/J*(F*(Sc*F.transpose())).sym();
-		const mat3ds sa = 1.0/J*(F*(Sa*F.transpose())).sym();
-		const mat3ds sx = 1.0/J*(F*(Sx*F.transpose())).sym();
 
-		const tens4dmm Ixsx = dyad1mm(I,sx);
-		const tens4dmm smxI = dyad1mm(sm,I);
-		const tens4dmm scxI = dyad1mm(sc,I);
-		const tens4dmm saxI = dyad1mm(sa,I);
+		if (tangent) {
+			// spatial moduli for elastin vanish: phieo/J*(FcF:GecGe:Cehat:GecGe:FTcFT) = phieo/J*(FcF:GecGe:0:GecGe:FTcFT)
 
-		const mat3ds tenr = dyad(F*(Fio*N[0]));						// Fio needed for consistency (from computation of lr)
-		const mat3ds tent = dyad(F*(Fio*N[1]));
-		const mat3ds tenz = dyad(F*(Fio*N[2]));
+			const double* eigenval = sd.lam;
+			const vec3d*  eigenvec = sd.v;
 
-		const tens4dmm Ixnrr = dyad1mm(I,tenr);
-		const tens4dmm Ixntt = dyad1mm(I,tent);
+			//compute tangent
 
-		// contribution due to constant Cauchy stresses at constituent level
-		tens4dmm cfss(0.0);
+			// compute current stresses
+			sNm = smo;										// phim*smhato = phim*smo
+			sNc = sco;										// phic*schato = phic*sco
+			if (ACTIVE) sNa = ract*sao;						// phim*ract*sao
 
-		sfpro.zero();
-		sfpro(0,0) = eigenvec[0]*((phim*sNm+phic*sNc+phim*sNa)*eigenvec[0]);
-		sfpro(1,1) = eigenvec[1]*((phim*sNm+phic*sNc+phim*sNa)*eigenvec[1]);
-		sfpro(2,2) = eigenvec[2]*((phim*sNm+phic*sNc+phim*sNa)*eigenvec[2]);
-		sfpro(0,1) = eigenvec[0]*((phim*sNm+phic*sNc+phim*sNa)*eigenvec[1]);
-		sfpro(1,2) = eigenvec[1]*((phim*sNm+phic*sNc+phim*sNa)*eigenvec[2]);
-		sfpro(0,2) = eigenvec[0]*((phim*sNm+phic*sNc+phim*sNa)*eigenvec[2]);
+			// 2nd P-K stresses
+			const mat3ds Sm = J*(ui*sNm*ui).sym();						// J*Ui*sNm*Ui
+			const mat3ds Sc = J*(ui*sNc*ui).sym();						// J*Ui*sNc*Ui
 
-		vec3d Fxeigenvec[3];
+			// associated Cauchy stresses
+			const mat3ds sm = 1.0/J*(F*(Sm*F.transpose())).sym();
+			const mat3ds sc = 1.0/J*(F*(Sc*F.transpose())).sym();
+			const mat3ds sx = 1.0/J*(F*(Sx*F.transpose())).sym();
 
-		Fxeigenvec[0] = F*eigenvec[0];
-		Fxeigenvec[1] = F*eigenvec[1];
-		Fxeigenvec[2] = F*eigenvec[2];
 
-		for (int i=0; i<3; i++) {
+			const mat3ds tenr = dyad(F*(Fio*N[0]));						// Fio needed for consistency (from computation of lr)
+			const mat3ds tent = dyad(F*(Fio*N[1]));
+			const mat3ds tenz = dyad(F*(Fio*N[2]));
 
-			mat3ds ten1 = dyad(Fxeigenvec[i]);
+			// all contributions are accumulated in css_v
+			GRVoigt css_v;
 
-			for (int j=0; j<3; j++) {
+			// contribution due to constant Cauchy stresses at constituent level
 
-				double component = sfpro(i,j) / pow(eigenval[i],3) / eigenval[j];
+			mat3ds sfpro;
+			sfpro.zero();
+			const mat3ds sNx = (ACTIVE ? phim*sNm+phic*sNc+phim*sNa : phim*sNm+phic*sNc);
+			sfpro(0,0) = eigenvec[0]*(sNx*eigenvec[0]);
+			sfpro(1,1) = eigenvec[1]*(sNx*eigenvec[1]);
+			sfpro(2,2) = eigenvec[2]*(sNx*eigenvec[2]);
+			sfpro(0,1) = eigenvec[0]*(sNx*eigenvec[1]);
+			sfpro(1,2) = eigenvec[1]*(sNx*eigenvec[2]);
+			sfpro(0,2) = eigenvec[0]*(sNx*eigenvec[2]);
 
-				mat3ds ten2 = dyads(Fxeigenvec[i],Fxeigenvec[j]);
+			// the contribution is assembled from its coefficients K in the pushed forward eigenbasis
+			// of U, cfss = -sum_AB K(A,B) T(A)xT(B), with T(A) = fi x fi for A = (i,i) and
+			// T(A) = fi x fj + fj x fi for A = (i,j), i<j, where fi = F*eigenvec[i]
+			vec3d Fxeigenvec[3];
 
-				cfss -= component*dyad1mm(ten2,ten1);
+			Fxeigenvec[0] = F*eigenvec[0];
+			Fxeigenvec[1] = F*eigenvec[1];
+			Fxeigenvec[2] = F*eigenvec[2];
 
-				for (int k=0; k<3; k++) {
+			double K[6][6] = {{0.0}};
 
-					if (k == i) continue;
+			for (int i=0; i<3; i++) {
+				for (int j=0; j<3; j++) {
 
-					mat3ds ten3 = dyads(Fxeigenvec[j],Fxeigenvec[k]);
-					mat3ds ten4 = dyads(Fxeigenvec[k],Fxeigenvec[i]);
+					// -sfpro(i,j)/li^3/lj * dyads(fi,fj) x dyad(fi)
+					K[VOIGT[i][j]][VOIGT[i][i]] += sfpro(i,j) / (eigenval[i]*eigenval[i]*eigenval[i]) / eigenval[j] * (i == j ? 2.0 : 1.0);
 
-					component = sfpro(i,j) / eigenval[i] / eigenval[j] / eigenval[k] / (eigenval[i] + eigenval[k]);
+					// -sfpro(i,j)/(li*lj*lk*(li+lk)) * dyads(fj,fk) x dyads(fk,fi)
+					for (int k=0; k<3; k++) {
+						if (k == i) continue;
+						K[VOIGT[j][k]][VOIGT[k][i]] += sfpro(i,j) / (eigenval[i]*eigenval[j]*eigenval[k]*(eigenval[i] + eigenval[k])) * (j == k ? 2.0 : 1.0);
+					}
+				}
+			}
 
-					cfss -= component*dyad1mm(ten3,ten4);
+			GRVoigtVec T[6];
+			T[0] = dyad(Fxeigenvec[0]);
+			T[1] = dyad(Fxeigenvec[1]);
+			T[2] = dyad(Fxeigenvec[2]);
+			T[3] = dyads(Fxeigenvec[0],Fxeigenvec[1]);
+			T[4] = dyads(Fxeigenvec[1],Fxeigenvec[2]);
+			T[5] = dyads(Fxeigenvec[0],Fxeigenvec[2]);
+
+			// push forward: one dyadic product per row of K
+			for (int A=0; A<6; A++) {
+				GRVoigtVec KT;
+				bool bnz = false;
+				for (int l=0; l<6; l++) KT.v[l] = 0.0;
+				for (int B=0; B<6; B++) {
+					if (K[A][B] == 0.0) continue;
+					for (int l=0; l<6; l++) KT.v[l] += T[B].v[l]*K[A][B];
+					bnz = true;
 				}
+				if (bnz) css_v.Dyad(-1.0, T[A], KT);
 			}
-		}
 
-		const double dphiRm = phimo*eta*pow(J/Jo*phic/phico,eta-1.0)/(phimo*eta*pow(J/Jo*phic/phico,eta-1.0)+phico);
-		const double dphiRc = phico/(phimo*eta*pow(J/Jo*phic/phico,eta-1.0)+phico);
+			const double dphiRm = phimo*eta*xe1/(phimo*eta*xe1+phico);
+			const double dphiRc = phico/(phimo*eta*xe1+phico);
 
-		cfss += dphiRm*(smxI+saxI) + dphiRc*scxI;
+			// dphiRm*(sm x I) + dphiRc*(sc x I) (+ dphiRm*(sa x I) with active tone)
+			mat3ds sRxI = dphiRm*sm + dphiRc*sc;
 
-		// contribution due to the ratio of vasocontrictors to vasodilators in the active stress
-		const tens4dmm saoxnrr = dyad1mm((R*sao*R.transpose()).sym(),tenr);
-		const tens4dmm saoxntt = dyad1mm((R*sao*R.transpose()).sym(),tent);
+			if (ACTIVE && Cratio>0) {
+				// active Cauchy stress per unit phim, like sm and sc (1/J*F*Sa*Ft = phim*ract*R*sao*Rt)
+				const mat3ds sa = (R*sao*R.transpose()).sym();
 
-		// 1/J * FoF : [ J * phim * 1/(1.0-exp(-CB*CB)) * (Ui*sao*Ui) x d(1-exp(-Cratio^2))/d(C/2) ] : (Ft)o(Ft)
-		const tens4dmm cass = phim * 6.0*Cratio*CS*EPS*pow(rIrIo,-4)*exp(-Cratio*Cratio)/(1.0-exp(-CB*CB)) * (ro/rIo/lt*saoxntt-(ro-rIo)/rIo/lr*saoxnrr);
+				sRxI += dphiRm*ract*sa;
 
-		// contribution due to change in Cauchy stresses at constituent level (orientation only, for now)
-		tens4dmm cpnss(0.0);
+				// contribution due to the ratio of vasocontrictors to vasodilators in the active stress
+				// 1/J * FoF : [ J * phim * 1/(1.0-exp(-CB*CB)) * (Ui*sao*Ui) x d(1-exp(-Cratio^2))/d(C/2) ] : (Ft)o(Ft)
+				// = k * (R*sao*Rt) x (ro/rIo/lt*tent-(ro-rIo)/rIo/lr*tenr)
+				const double k = phim * 6.0*Cratio*CS*EPS*rIrIo4*eC/aCB;
+				css_v.Dyad(k, sa, ro/rIo/lt*tent-(ro-rIo)/rIo/lr*tenr);
+			}
 
-		const double scphato = cc*(lcp2-1.0)*exp(dc*(lcp2-1.0)*(lcp2-1.0))*(Gc*Gc);	// constant stress magnitude at constituent level
-		const double scnhato = cc*(lcn2-1.0)*exp(dc*(lcn2-1.0)*(lcn2-1.0))*(Gc*Gc);
+			css_v.AxI(1.0, sRxI);
 
-		const vec3d dNpdta = (N[1]-N[2]*tan(alpha))*pow(1+pow(tan(alpha),2),-1.5);	// d(Np)/d(tan(alpha))
-		const vec3d dNndta = (N[1]+N[2]*tan(alpha))*pow(1+pow(tan(alpha),2),-1.5);
+			// contribution due to change in Cauchy stresses at constituent level (orientation only, for now)
+			if (ALIGN) {
+				const mat3ds Uo = ho.Uo;
 
-		const mat3ds ten1 = 1.0/Jo*dyads(R*(Uo*dNpdta),R*(Uo*Np));					// FoF : (Ui)o(Ui) : d(NpxNp)/d(tan(alpha)), with Jo and Uo needed for consistency (from computation of sco)
-		const mat3ds ten2 = 1.0/Jo*dyads(R*(Uo*dNndta),R*(Uo*Nn));
+				const vec3d dNpdta = (N[1]-N[2]*ta)*(ca*ca*ca);		// d(Np)/d(tan(alpha)), with (1+tan(alpha)^2)^-1.5 = cos(alpha)^3
+				const vec3d dNndta = (N[1]+N[2]*ta)*(ca*ca*ca);
 
-		const mat3ds ten3 = aexp*tan(alpha)*(1.0/(lt*lt)*tent-1.0/(lz*lz)*tenz);		// 2*d(tan(alpha))/d(C) : (Ft)o(Ft)
+				const mat3ds ten1 = 1.0/Jo*dyads(R*(Uo*dNpdta),R*(Uo*Np));					// FoF : (Ui)o(Ui) : d(NpxNp)/d(tan(alpha)), with Jo and Uo needed for consistency (from computation of sco)
+				const mat3ds ten2 = 1.0/Jo*dyads(R*(Uo*dNndta),R*(Uo*Nn));
 
-		cpnss += (phic*betad) * scphato * dyad1mm(ten1,ten3);					// 1/J * FoF : [ J * phicp * scphato * (Ui)o(Ui) : 2*d(NpxNp)/d(C) ] : (Ft)o(Ft)
-		cpnss += (phic*betad) * scnhato * dyad1mm(ten2,ten3);
+				const mat3ds ten3 = aexp*ta*(1.0/(lt*lt)*tent-1.0/(lz*lz)*tenz);		// 2*d(tan(alpha))/d(C) : (Ft)o(Ft)
 
-		const tens4dmm cess = tens4dmm(ce);							// ce in tens4dmm form
+				// 1/J * FoF : [ J * phicp * scphato * (Ui)o(Ui) : 2*d(NpxNp)/d(C) ] : (Ft)o(Ft), idem for symmetric
+				css_v.Dyad(phic*betad, scphato*ten1 + scnhato*ten2, ten3);
+			}
 
-		css = cess + cfss + cass + cpnss;
+			// 1/3*(2*tr(sx)*IoI - 2*Ixsx - IxI:css) + pv*(IxI-2*IoI) - kv*Ix(ro/rIo/lt*tent-(ro-rIo)/rIo/lr*tenr),
+			// with the deviatoric projection applied in place
+			const double pv = svo/(1.0-delta)*(1.0+KsKi*(EPS*rIrIo3-1.0)-(INFLAM ? KfKi*inflam : 0.0));
+			const double kv = 3.0*svo/(1.0-delta)*KsKi*EPS*rIrIo4;
 
-		css += 1.0/3.0*(2.0*sx.tr()*IoIss-2.0*Ixsx-ddot(IxIss,css))
-			 + svo/(1.0-delta)*(1.0+KsKi*(EPS*pow(rIrIo,-3)-1.0)-KfKi*inflam)*(IxIss-2.0*IoIss)
-			 - 3.0*svo/(1.0-delta)*KsKi*EPS*pow(rIrIo,-4)*(ro/rIo/lt*Ixntt-(ro-rIo)/rIo/lr*Ixnrr);
+			css_v.DevLeft();
+			css_v.IoI(2.0/3.0*sx.tr() - 2.0*pv);
+			css_v.IxI(pv);
+			css_v.IxB(1.0, -2.0/3.0*sx - kv*(ro/rIo/lt*tent-(ro-rIo)/rIo/lr*tenr));
+
+			css = css_v.Tens4dmm();
+		}
 	}
 
 	mat3ds s = 1.0/J*((F*(S*F.transpose()))).sym();
 	stress = s;
 
-	pt.m_Iemax = s.dotdot(dyad(F*N[1]))/(F*N[1]).norm2();			// circumferential stress, just for plotting, temporary
+	pt.m_stt = (gr_real) (s.dotdot(dyad(F*N[1]))/(F*N[1]).norm2());		// circumferential stress, for plotting
 
-	tangent = css;
+	if (tangent) *tangent = css;
 }
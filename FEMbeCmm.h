@@ -13,31 +13,242 @@
 // We need to include this file since our new material class will inherit from
 // FEElasticMaterial which is defined in this include files.
 #include "FEBioMech/FEElasticMaterial.h"
+#include "GRCenterline.h"
 #include <iostream>								// to use cin.get()
+#include <atomic>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// floating point type of the derived (recomputable) per point quantities.
+// Build with -DGR_SINGLE_PRECISION to store them in single precision. The history
+// (m_Jo, m_Fio, m_svo, m_phic and their trial values) is always kept in double.
+#ifdef GR_SINGLE_PRECISION
+typedef float gr_real;
+#else
+typedef double gr_real;
+#endif
+
+// vector stored in gr_real precision
+struct GRVec
+{
+	gr_real		x, y, z;
+
+	GRVec& operator = (const vec3d& a) { x = (gr_real) a.x; y = (gr_real) a.y; z = (gr_real) a.z; return *this; }
+	operator vec3d() const { return vec3d(x, y, z); }
+};
+
+// symmetric tensor stored in gr_real precision
+struct GRSym
+{
+	gr_real		m[6];
+
+	GRSym& operator = (const mat3ds& a) { for (int i = 0; i < 6; i++) m[i] = (gr_real) a.m[i]; return *this; }
+	operator mat3ds() const { mat3ds a; for (int i = 0; i < 6; i++) a.m[i] = m[i]; return a; }
+};
+
+//-----------------------------------------------------------------------------
+// Time-invariant local data of a material point. Only depends on the reference
+// position, so it is evaluated once (on the first material evaluation) and reused.
+// The diagonal fiber directions and the elastin stress follow cheaply from N.
+struct GRLocalFrame
+{
+	GRVec		N[3];		//!< local radial, circumferential and axial directions
+	gr_real		ro;			//!< radial distance to the center line
+	gr_real		rIo;		//!< reference inner radius at the nearest center line point
+	bool		valid;		//!< true once the above have been evaluated
+};
+
+//-----------------------------------------------------------------------------
+// Kinematic quantities of a deformation gradient F that all follow from one
+// spectral decomposition of the right Cauchy-Green tensor C = Ft*F.
+struct GRSpectral
+{
+	double		lam[3];		//!< principal stretches (eigenvalues of U) in ascending order
+	vec3d		v[3];		//!< orthonormal principal directions (eigenvectors of C and U)
+	mat3ds		C;			//!< right Cauchy-Green tensor
+	mat3ds		Ci;			//!< inverse of C
+	mat3ds		U;			//!< right stretch tensor
+	mat3ds		Ui;			//!< inverse of U
+	mat3d		R;			//!< rotation of the polar decomposition F = R*U
+};
+
+// evaluates all quantities of GRSpectral for the deformation gradient F
+void GRSpectralDecomposition(const mat3d& F, GRSpectral& sd);
+
+//-----------------------------------------------------------------------------
+// Stretches of the local directions of a material point, shared by the kernels.
+// Prestress: |F*N[1]|, |F*N[2]|, |F*Np|, |F*Nn|.
+// G&R: |F*Fio*N[0]|, |F*Fio*N[1]|, |F*Fio*N[2]|.
+struct GRStretch
+{
+	double		l[4];
+};
+
+// Model constants that can vary between the members of an ensemble (see FEMbeCmm::StressTangentEnsemble)
+struct GRParams
+{
+	double		KsKi;		//!< gain of the volumetric stress response to wall shear stress
+	double		eta;		//!< smc to collagen mass production ratio exponent
+	double		cc;			//!< collagen stiffness
+	double		dc;			//!< collagen exponential coefficient
+	double		betat;		//!< fraction of circumferential collagen
+	double		betaz;		//!< fraction of axial collagen
+	double		alpha;		//!< original orientation of diagonal collagen
+};
+
+// homeostatic quantities derived from the state at the end of prestressing (Jo, Fio) and the
+// original fiber orientation. Evaluated on the first G&R evaluation of a point.
+struct GRHomeostatic
+{
+	GRSym		smo;		//!< Cauchy stress of smooth muscle cells at o
+	GRSym		sco;		//!< Cauchy stress of collagen at o (without the diagonal families if they reorient)
+	GRSym		sao;		//!< active Cauchy stress at o per unit Tmax
+	GRSym		Uo;			//!< right stretch tensor at o
+	gr_real		scphato;	//!< stress magnitude of diagonal collagen at constituent level
+	gr_real		scnhato;	//!< idem for symmetric
+	int			state;		//!< 0 = invalid, 1 = Uo only, 2 = complete
+	bool		align;		//!< sco was evaluated for reorienting diagonal families
+};
+
+// material response of the last evaluation of a point (see FEMbeCmm::m_cache)
+struct GRResultCache
+{
+	mat3d		F;			//!< deformation gradient of the cached evaluation
+	double		t;			//!< time of the cached evaluation
+	mat3ds		s;			//!< cached Cauchy stress
+	tens4dmm	c;			//!< cached spatial tangent
+	int			state;		//!< 0 = empty, 1 = stress and tangent
+};
+
+// spatial tangent of a point reused while F stays close to the F it was evaluated at (see FEMbeCmm::m_lagTangent)
+struct GRLaggedTangent
+{
+	mat3d		F;			//!< deformation gradient the tangent was evaluated at
+	tens4dmm	c;			//!< lagged spatial tangent
+	mat3d		Fs;			//!< deformation gradient of the last evaluation
+	double		ts;			//!< time of the last evaluation
+	mat3ds		s;			//!< Cauchy stress of the last evaluation
+	int			state;		//!< 0 = empty, bit 1 = tangent valid, bit 2 = last evaluation valid
+};
+
+// material parameter overrides of a scenario continued in a forked worker (see FEMbeCmm::FanOut)
+struct GRScenario
+{
+	std::string										name;	//!< scenario name (used for its output file)
+	std::vector<std::pair<std::string, double> >	par;	//!< parameter name and value
+};
+
+// forked worker process of a scenario
+struct GRWorker
+{
+	int			pid;		//!< process id
+	int			scenario;	//!< index in FEMbeCmm::m_scenarios
+	double		tstart;		//!< wall clock time of the fork [s]
+	double		twall;		//!< wall clock time from fork to exit [s]
+	double		tcpu;		//!< user and system time of the worker [s]
+	int			status;		//!< exit code (-1 if terminated by a signal or reaped elsewhere)
+	bool		done;		//!< set once the worker has exited
+	int			cpu;		//!< core the worker is pinned to (-1 if not pinned)
+};
+
+// number of bins of the phic iteration histogram (the last bin collects all larger counts)
+#define GR_PHIC_BINS 8
+
+// counters and timers of the material evaluation, collected if the material's statistics flag is set
+// and reset after each time step. Times are in ns.
+struct GRStatistics
+{
+	std::atomic<long>		ncall[2][2];			//!< evaluations per branch (0 = prestress, 1 = G&R) and type (0 = stress, 1 = stress and tangent)
+	std::atomic<long>		nphicIter[GR_PHIC_BINS];	//!< histogram of phic iterations
+	std::atomic<long>		nphicBisect;			//!< phic iterations that fell back to bisection
+	std::atomic<long long>	tframe;					//!< local frame evaluation
+	std::atomic<long long>	tkinematics;			//!< local frame and stretches
+	std::atomic<long long>	tkernel[2];				//!< material kernels per branch
+	std::atomic<long long>	tphic;					//!< phic solves
+
+	void Reset();
+
+	// adds the counters of st and resets them
+	void Collect(GRStatistics& st);
+};
+
+// counters of the evaluations on one thread. Each thread of the parallel element loops counts into
+// its own slot (padded to separate cache lines), the slots are summed by FEMbeCmm::ReportStatistics.
+struct GRThreadCounters
+{
+	GRStatistics		stat;					//!< evaluation statistics of the current time step
+	std::atomic<long>	ncacheHit;				//!< number of evaluations served from the result cache
+	std::atomic<long>	ncacheMiss;				//!< number of evaluations that had to be computed
+	std::atomic<long>	nphicFail;				//!< number of phic solves that hit the iteration limit
+	std::atomic<long>	nlagReuse;				//!< number of tangents served from the lagged tangent
+	std::atomic<long>	nlagEval;				//!< number of tangents (re)computed in lagged tangent mode
+	char				pad[64];				//!< keeps the next slot off the last cache line of this one
+};
 
 class FEBIOMECH_API GRMaterialPoint : public FEMaterialPointData
 {
 public:
-	GRMaterialPoint(FEMaterialPointData *pt) : FEMaterialPointData(pt) {};
+	GRMaterialPoint(FEMaterialPointData *pt) : FEMaterialPointData(pt) { m_ho.state = 0; m_frame.valid = false; m_rc = nullptr; m_lt = nullptr; };
+	~GRMaterialPoint() { delete m_rc; delete m_lt; }
+
+	// a copy owns its own result cache, lagged tangent and next point data (no assignment,
+	// which would leak or double free them)
+	GRMaterialPoint(const GRMaterialPoint& pt);
+	GRMaterialPoint& operator = (const GRMaterialPoint& pt) = delete;
 
 	FEMaterialPointData* Copy() override;
 
 	void Init() override;
+	void Update(const FETimeInfo& timeInfo) override;
 	void Serialize(DumpStream& ar) override;
 
+	// commits the trial state (also called by Update)
+	void Commit();
+
+	// resets the data that is re-evaluated from the history on first use
+	void InvalidateDerived();
+
+	// copies the history, output and derived data (but not the result cache or lagged tangent)
+	void CopyState(const GRMaterialPoint& pt);
+
 public:
 	// original (o) homeostatic data
 	double		m_Jo;		//!< Jacobian at o
-	double		m_svo;		//!< volumetric stress at o
-	mat3ds		m_smo;		//!< Cauchy stress tensor for smooth muscle cells at o
-	mat3ds		m_sco;		//!< Cauchy stress tensor for all collagen fiber families at o
 	mat3d		m_Fio;		//!< inverse of deformation gradient tensor at o
-	double		m_Jh;		//!< Jacobian at h
-	mat3d		m_Fih;		//!< inverse of deformation gradient tensor at h
+	double		m_svo;		//!< volumetric stress at o
 
 	// evolved homeostatic (h) data
 	double		m_phic;		//!< total mass fraction of all collagen fiber families at h
-	double		m_Iemax;	//!< maximum value of Ie achieved over the loading history up until the current G&R time
+
+	// trial state of the current iteration (committed in Update)
+	double		m_svoT;		//!< volumetric stress (prestress)
+	double		m_phicT;	//!< total mass fraction of all collagen fiber families
+	bool		m_bpreT;	//!< trial state was evaluated during prestress
+
+	// time of the current step, set by Update when FEBio opens the step (before its first evaluation),
+	// so the evaluations in the parallel element loops read it from the point instead of the model
+	double		m_t;
+
+	// state seen by the adaptive time step control at the end of the last converged step
+	double		m_JJoP;		//!< volume ratio J/Jo
+	double		m_rIrIoP;	//!< inner radius relative to its homeostatic value
+
+	// output of the last evaluation (for plotting, see FEMbeCmmPlot.h)
+	gr_real		m_stt;		//!< circumferential Cauchy stress
+	gr_real		m_phim;		//!< mass fraction of smooth muscle cells
+	gr_real		m_rIrIo;	//!< inner radius relative to its homeostatic value
+	gr_real		m_act;		//!< active tone relative to its homeostatic value (0 without active tone)
+
+	// cached data, derived from the history and the material position
+	GRHomeostatic	m_ho;		//!< frozen homeostatic state (valid for t > 1)
+	GRLocalFrame	m_frame;	//!< local basis and radii
+
+	// cached material response (only allocated if the material's result_cache flag is set)
+	GRResultCache*	m_rc;
+
+	// lagged tangent (only allocated if the material's lagged_tangent flag is set)
+	GRLaggedTangent*	m_lt;
 };
 
 //-----------------------------------------------------------------------------
@@ -48,10 +259,14 @@ class FEMbeCmm : public FEElasticMaterial
 {
 public:
 	FEMbeCmm(FEModel* pfem);
+	~FEMbeCmm();
 
 	//! create material point data for this material
 	FEMaterialPointData* CreateMaterialPointData() override;
 
+	//! initialization
+	bool Init() override;
+
 public:
 	// The constructor is called when an instance of this class is created.
 	// All classes registered by the framework must take the FEModel* as the only
@@ -64,19 +279,142 @@ public:
 	// 	 { return m_secant_tangent; }
     bool m_secant_tangent;   //!< flag for using secant tangent
 
+	bool m_cache;			//!< flag for reusing the last stress/tangent of a point for an identical F and time
+
+	bool	m_lagTangent;	//!< flag for reusing the G&R tangent of a point while F changes less than m_lagTol
+	double	m_lagTol;		//!< largest change of a component of F for which the lagged tangent is reused
+
+	// regime constants (the defaults reproduce the KNOCKOUTS setup without active tone)
+	double	m_Tmax;			//!< maximal active stress
+	double	m_eta;			//!< smc to collagen mass production ratio exponent
+	double	m_aexp;			//!< exponent of the collagen reorientation law (0 = no reorientation)
+	double	m_delta;		//!< fraction of the homeostatic volumetric stress that is not restored
+	double	m_KfKi;			//!< gain of the inflammatory contribution
+	double	m_inflam;		//!< inflammation level reached at the end time
+	double	m_EPS;			//!< ratio of vasoconstrictors to vasodilators reached at the end time
+	double	m_KsKi;			//!< gain of the volumetric stress response to wall shear stress
+	double	m_cc;			//!< collagen stiffness
+	double	m_dc;			//!< collagen exponential coefficient
+	double	m_betat;		//!< fraction of circumferential collagen
+	double	m_betaz;		//!< fraction of axial collagen
+
+	int		m_phicMaxIter;	//!< maximum number of iterations of the local phic solve
+
+	bool		m_stats;		//!< flag for collecting evaluation counters and timers
+	std::string	m_statsFile;	//!< CSV file the statistics of each time step are appended to (optional)
+
+	std::string	m_snapshotSave;	//!< file the homeostatic state is written to at t = 1 (optional)
+	std::string	m_snapshotLoad;	//!< file the homeostatic state is loaded from, to start in G&R (optional)
+
+	std::string	m_ensembleFile;		//!< parameter sets evaluated at the end of each time step (optional)
+	std::string	m_ensembleOutput;	//!< CSV file the ensemble results are appended to (optional)
+
+	std::string	m_fanoutFile;		//!< scenarios continued in forked workers from the state at m_fanoutTime (optional)
+	double		m_fanoutTime;		//!< time at which the workers are forked
+	int			m_fanoutJobs;		//!< maximum number of concurrent workers (0 = number of cores - 1)
+	std::string	m_fanoutOutput;		//!< prefix of the per-scenario and summary CSV files
+
+	std::string	m_centerlineFile;	//!< discretised center line with reference inner radii (optional, default: analytic)
+
+	bool	m_adapt;		//!< flag for setting the G&R time step from the per-step changes of the points
+	double	m_dphicTol;		//!< target maximum change of phic per step
+	double	m_dJJoTol;		//!< target maximum change of J/Jo per step
+	double	m_drIrIoTol;	//!< target maximum change of rIrIo per step
+	double	m_adaptDtMin;	//!< lower bound of the suggested time step
+	double	m_adaptDtMax;	//!< upper bound of the suggested time step
+
     DECLARE_FECORE_CLASS();
 
 public:
-	// function to perform material evaluation. calculates stress and tangent to avoid code duplication
-	void StressTangent(FEMaterialPoint& mp, mat3ds& stress, tens4dmm& tangent);
+	// writes the result cache, local solver and (if enabled) evaluation statistics of the last time step to the log
+	void ReportStatistics();
+
+	// sets the next time step from the largest changes of phic, J/Jo and rIrIo over the converged step
+	// (with the auto time stepper on, caps its dtmax instead)
+	void AdaptTimeStep();
+
+	double	m_stepperDtMax;		//!< dtmax of the auto time stepper without the cap
+	double	m_stepperDtCap;		//!< dtmax last set by AdaptTimeStep (< 0 if none)
+
+	// writes / loads the homeostatic state of all material points and the nodal displacements
+	bool SaveSnapshot(const char* szfile);
+	bool LoadSnapshot(const char* szfile);
+
+	// collects the material points of all domains of this material
+	void MaterialPoints(std::vector<FEMaterialPoint*>& mp);
+
+	bool	m_bsnapshotSaved;	//!< set once the homeostatic snapshot is written
+
+	// reads the ensemble parameter sets / evaluates and reports them at the converged state
+	bool ReadEnsemble(const char* szfile);
+	void ReportEnsemble();
+
+	std::vector<GRParams>	m_ensemble;			//!< parameter sets of the ensemble members
+	bool					m_bensembleHeader;	//!< set once the CSV header is written
+
+	// reads the scenarios / forks the workers at the branch time / appends the state of a step to the
+	// scenario's CSV file / waits for the workers and writes the summary (in the parent)
+	bool ReadScenarios(const char* szfile);
+	bool FanOut();
+	void WriteScenarioStep();
+	void CollectScenarios();
+
+	// returns false (with an error) if the process runs more than one OpenMP thread
+	bool CanFork();
+
+	std::vector<GRScenario>	m_scenarios;	//!< scenarios read from m_fanoutFile
+	std::vector<GRWorker>	m_workers;		//!< workers forked by this process
+	int						m_scenario;		//!< -1 before the fan-out, 0 in the parent (nominal), k in the worker of scenario k-1
+	double					m_tfanout;		//!< wall clock time of the fan-out [s]
+
+	GRCenterline	m_centerline;	//!< center line read from m_centerlineFile (empty for the analytic one)
+
+private:
+	// returns the counters of the calling thread (or of the ensemble evaluations)
+	GRThreadCounters& Counters();
+
+	GRThreadCounters*	m_tc;			//!< per thread counters, followed by the slot of the ensemble evaluations
+	int					m_ntc;			//!< number of per thread counters
+	bool				m_bensembleEval;	//!< set while ReportEnsemble evaluates the ensemble
+	bool				m_bcallback;	//!< set once the log callback is registered
+	bool				m_bstatsHeader;	//!< set once the CSV header is written
+
+public:
+	// function to perform material evaluation. calculates stress and tangent to avoid code duplication.
+	// the tangent is only assembled if a tangent is passed (stress only otherwise). Only the point's
+	// own data is written, so different points can be evaluated concurrently.
+	void StressTangent(FEMaterialPoint& mp, mat3ds& stress, tens4dmm* tangent);
+
+	// material evaluation with the terms that vanish for the regime constants removed at compile time:
+	// ACTIVE (Tmax != 0), ETA (eta != 1), INFLAM (KfKi*inflam != 0), ALIGN (aexp != 0).
+	// StressTangent dispatches to the matching instance; <true,true,true,true> is the generic kernel.
+	// pt holds the history (the point's own data, or a copy for ensemble members) and par the model constants.
+	template <bool ACTIVE, bool ETA, bool INFLAM, bool ALIGN>
+	void StressTangentT(FEMaterialPoint& mp, GRMaterialPoint& pt, const GRParams& par, const GRSpectral& sd, const GRStretch& st, mat3ds& stress, tens4dmm* tangent);
+
+	typedef void (FEMbeCmm::*GRKernel)(FEMaterialPoint& mp, GRMaterialPoint& pt, const GRParams& par, const GRSpectral& sd, const GRStretch& st, mat3ds& stress, tens4dmm* tangent);
+
+	// returns the kernel for the regime constants (beta: eta != 1 for any evaluated parameter set)
+	GRKernel Kernel(bool beta) const;
+
+	// the nominal model constants
+	GRParams NominalParams() const;
+
+	// evaluates K parameter sets at the current deformation and history of a point without modifying its
+	// history. The members share the local frame, the spectral decomposition of F, the stretches and the
+	// polar decomposition of Fo; their frozen homeostatic stresses are re-derived from the shared history.
+	// stress and (if not null) tangent are arrays of size K.
+	void StressTangentEnsemble(FEMaterialPoint& mp, const GRParams* par, int K, mat3ds* stress, tens4dmm* tangent);
+
+	// returns the time-invariant local data of a material point (evaluated on first use)
+	const GRLocalFrame& LocalFrame(FEMaterialPoint& mp);
 
 	// This function calculates the spatial (i.e. Cauchy or true) stress.
 	// It takes one parameter, the FEMaterialPoint and returns a mat3ds object
 	// which is a symmetric second-order tensor.
 	virtual mat3ds Stress(FEMaterialPoint& pt) override {
 		mat3ds stress;
-		tens4dmm tangent;
-		StressTangent(pt, stress, tangent);
+		StressTangent(pt, stress, nullptr);
 		return stress;
 	}
 
@@ -92,7 +430,7 @@ public:
 	virtual tens4dmm SecantTangent(FEMaterialPoint& pt) {
 		mat3ds stress;
 		tens4dmm tangent;
-		StressTangent(pt, stress, tangent);
+		StressTangent(pt, stress, &tangent);
 		return tangent;
 	}
 
@@ -0,0 +1,296 @@
+// Scenario fan-out of the G&R material (mbe_cmm): the model is loaded and solved once up to the
+// branch time (fanout_time), then one worker process per scenario is forked. The workers share the
+// solved state copy-on-write, override material parameters and continue the analysis on their own
+// core (of the cores the process may run on), without plot file or log output. Each process appends
+// the state of its converged steps to <fanout_output>_<scenario>.csv (the parent runs the nominal
+// parameters, <fanout_output>_nominal.csv), and the parent writes the exit codes and timings of all
+// workers to <fanout_output>_summary.csv.
+// Requires OMP_NUM_THREADS=1, the OpenMP runtime is not usable in a forked child of a threaded parent.
+#include "FEMbeCmm.h"
+#include "FECore/FEAnalysis.h"
+#include "FECore/FEModel.h"
+#include "FECore/log.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// wall clock time in s
+static double GRWallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the workers are forked from the thread that runs the analysis, which is only safe without an OpenMP team
+bool FEMbeCmm::CanFork()
+{
+#ifdef _OPENMP
+	if (omp_get_max_threads() > 1) {
+		feLogError("mbe_cmm: scenario fan-out needs OMP_NUM_THREADS=1 (running with %d threads)\n", omp_get_max_threads());
+		return false;
+	}
+#else
+	// built without the OpenMP runtime, FEBio's own team size follows OMP_NUM_THREADS (all cores if unset)
+	const char* sz = getenv("OMP_NUM_THREADS");
+	if ((sz == nullptr) || (atoi(sz) != 1)) {
+		feLogError("mbe_cmm: scenario fan-out needs OMP_NUM_THREADS=1\n");
+		return false;
+	}
+#endif
+	return true;
+}
+
+// reads the scenarios, one line per scenario with a name followed by name=value parameter
+// overrides ('#' starts a comment), e.g. "active Tmax=250 eta=0.714"
+bool FEMbeCmm::ReadScenarios(const char* szfile)
+{
+	FILE* fp = fopen(szfile, "rt");
+	if (fp == nullptr) { feLogError("mbe_cmm: cannot open scenario file %s\n", szfile); return false; }
+
+	m_scenarios.clear();
+	char szline[1024];
+	int nline = 0;
+	while (fgets(szline, sizeof(szline), fp))
+	{
+		nline++;
+		char* ch = strchr(szline, '#');
+		if (ch) *ch = 0;
+
+		GRScenario sc;
+		bool bok = true;
+		for (char* tok = strtok(szline, " \t\r\n"); tok; tok = strtok(nullptr, " \t\r\n"))
+		{
+			if (sc.name.empty()) { sc.name = tok; continue; }
+
+			char* eq = strchr(tok, '=');
+			char* end = nullptr;
+			if (eq) { *eq = 0; strtod(eq + 1, &end); }
+			if ((eq == nullptr) || (end == eq + 1) || (*end != 0)) { bok = false; break; }
+
+			// only numerical parameters of this material can be overridden
+			FEParam* p = FindParameter(ParamString(tok));
+			if ((p == nullptr) || ((p->type() != FE_PARAM_DOUBLE) && (p->type() != FE_PARAM_INT) && (p->type() != FE_PARAM_BOOL))) {
+				feLogError("mbe_cmm: unknown parameter %s in line %d of %s\n", tok, nline, szfile);
+				fclose(fp);
+				return false;
+			}
+			sc.par.push_back(std::make_pair(std::string(tok), atof(eq + 1)));
+		}
+		if (!bok) {
+			feLogError("mbe_cmm: invalid scenario in line %d of %s\n", nline, szfile);
+			fclose(fp);
+			return false;
+		}
+		if (!sc.name.empty()) m_scenarios.push_back(sc);
+	}
+	fclose(fp);
+
+	feLog("mbe_cmm: %d scenarios read from %s\n", (int) m_scenarios.size(), szfile);
+
+	// fail before the shared part of the analysis is solved
+	return (m_scenarios.empty() || CanFork());
+}
+
+// waits for one worker to exit and records its exit code and timings. returns the worker's
+// index (-1 if there is none left to wait for). Only the workers' own pids are waited for (polled
+// every 10 ms), so children of the process that are not workers are left to their owner.
+static int WaitWorker(std::vector<GRWorker>& workers)
+{
+	for (;;)
+	{
+		bool brunning = false;
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			GRWorker& w = workers[i];
+			if (w.done) continue;
+
+			int status = 0;
+			struct rusage ru;
+			memset(&ru, 0, sizeof(ru));
+			const int pid = wait4(w.pid, &status, WNOHANG, &ru);
+			if ((pid == 0) || ((pid < 0) && (errno == EINTR))) { brunning = true; continue; }
+
+			// a worker that cannot be waited for (reaped elsewhere) counts as terminated abnormally
+			w.twall  = GRWallTime() - w.tstart;
+			w.tcpu   = ru.ru_utime.tv_sec + 1e-6*ru.ru_utime.tv_usec + ru.ru_stime.tv_sec + 1e-6*ru.ru_stime.tv_usec;
+			w.status = ((pid > 0) && WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+			w.done   = true;
+			return (int) i;
+		}
+		if (!brunning) return -1;
+		usleep(10000);
+	}
+}
+
+// forks one worker per scenario (at most fanout_jobs at a time, so the parent waits for a free slot
+// before forking the next one). returns in the parent, which continues with the nominal parameters,
+// and in each worker, which continues with the overrides of its scenario.
+bool FEMbeCmm::FanOut()
+{
+	if (!CanFork()) return false;
+
+	FEModel& fem = *GetFEModel();
+	const double t = fem.GetTime().currentTime;
+
+	// cores the process may run on: the first stays with the parent, the others are handed to the
+	// workers (no pinning if the process may only run on one core)
+	std::vector<int> cpus;
+#ifdef __linux__
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+		for (int i = 0; i < CPU_SETSIZE; i++) if (CPU_ISSET(i, &allowed)) cpus.push_back(i);
+	}
+	const int ncores = std::max((int) cpus.size(), 1);
+#else
+	const int ncores = std::max((int) sysconf(_SC_NPROCESSORS_ONLN), 1);
+#endif
+	if (!cpus.empty()) cpus.erase(cpus.begin());
+	const int njobs = (m_fanoutJobs > 0 ? m_fanoutJobs : std::max(ncores - 1, 1));
+
+	feLog("mbe_cmm: forking %d scenario workers at t = %lg (at most %d concurrent)\n", (int) m_scenarios.size(), t, njobs);
+
+	m_tfanout = GRWallTime();
+	m_workers.clear();
+	int nrunning = 0;
+	for (int k = 0; k < (int) m_scenarios.size(); k++)
+	{
+		while (nrunning >= njobs) {
+			const int i = WaitWorker(m_workers);
+			if (i < 0) break;
+			if (m_workers[i].cpu >= 0) cpus.push_back(m_workers[i].cpu);
+			nrunning--;
+		}
+
+		// buffered output would otherwise be written by the parent and every worker
+		fflush(nullptr);
+
+		const int pid = fork();
+		if (pid < 0) { feLogError("mbe_cmm: cannot fork the worker of scenario %s\n", m_scenarios[k].name.c_str()); return false; }
+
+		if (pid == 0) {
+			// worker: no plot, log or shared output files, on its own core (pinned by the parent)
+			m_scenario = k + 1;
+			m_workers.clear();
+			fem.BlockLog();
+			fem.GetCurrentStep()->SetPlotLevel(FE_PLOT_NEVER);
+			m_statsFile.clear();
+			m_ensemble.clear();
+			m_bsnapshotSaved = true;
+
+			const GRScenario& sc = m_scenarios[k];
+			for (size_t i = 0; i < sc.par.size(); i++)
+			{
+				FEParam* p = FindParameter(ParamString(sc.par[i].first.c_str()));
+				if      (p->type() == FE_PARAM_DOUBLE) p->value<double>() = sc.par[i].second;
+				else if (p->type() == FE_PARAM_INT   ) p->value<int>() = (int) sc.par[i].second;
+				else if (p->type() == FE_PARAM_BOOL  ) p->value<bool>() = (sc.par[i].second != 0.0);
+			}
+
+			// cached results and frozen data depend on the parameters
+			std::vector<FEMaterialPoint*> mp;
+			MaterialPoints(mp);
+			for (size_t i = 0; i < mp.size(); i++) mp[i]->ExtractData<GRMaterialPoint>()->InvalidateDerived();
+
+			break;
+		}
+
+		GRWorker w;
+		w.pid = pid;
+		w.scenario = k;
+		w.tstart = GRWallTime();
+		w.twall = w.tcpu = 0.0;
+		w.status = -1;
+		w.done = false;
+		w.cpu = -1;
+
+		// pin the worker to a free core (workers beyond the number of free cores are not pinned)
+#ifdef __linux__
+		if (!cpus.empty()) {
+			cpu_set_t cpu;
+			CPU_ZERO(&cpu);
+			CPU_SET(cpus.back(), &cpu);
+			if (sched_setaffinity(pid, sizeof(cpu), &cpu) == 0) { w.cpu = cpus.back(); cpus.pop_back(); }
+			else feLogWarning("mbe_cmm: cannot pin the worker of scenario %s to core %d\n", m_scenarios[k].name.c_str(), cpus.back());
+		}
+#endif
+		m_workers.push_back(w);
+		nrunning++;
+	}
+	if (m_scenario < 0) m_scenario = 0;
+
+	// start the output file of this process
+	const std::string name = (m_scenario == 0 ? std::string("nominal") : m_scenarios[m_scenario - 1].name);
+	FILE* fp = fopen((m_fanoutOutput + "_" + name + ".csv").c_str(), "wt");
+	if (fp) {
+		fprintf(fp, "time,phic_mean,rIrIo_mean,rIrIo_max,stt_mean,stt_max\n");
+		fclose(fp);
+	}
+
+	return true;
+}
+
+// appends the mean and maximum of the stored point state of the converged step to the scenario's CSV file
+void FEMbeCmm::WriteScenarioStep()
+{
+	const std::string name = (m_scenario == 0 ? std::string("nominal") : m_scenarios[m_scenario - 1].name);
+	FILE* fp = fopen((m_fanoutOutput + "_" + name + ".csv").c_str(), "at");
+	if (fp == nullptr) return;
+
+	std::vector<FEMaterialPoint*> mp;
+	MaterialPoints(mp);
+
+	double phic = 0.0, rIrIo = 0.0, stt = 0.0;
+	double rIrIomax = -std::numeric_limits<double>::max(), sttmax = -std::numeric_limits<double>::max();
+	for (size_t i = 0; i < mp.size(); i++)
+	{
+		const GRMaterialPoint& pt = *mp[i]->ExtractData<GRMaterialPoint>();
+		phic  += pt.m_phicT;
+		rIrIo += pt.m_rIrIo;
+		stt   += pt.m_stt;
+		rIrIomax = std::max(rIrIomax, (double) pt.m_rIrIo);
+		sttmax   = std::max(sttmax, (double) pt.m_stt);
+	}
+	const double np = std::max((double) mp.size(), 1.0);
+
+	fprintf(fp, "%lg,%lg,%lg,%lg,%lg,%lg\n", GetFEModel()->GetTime().currentTime, phic/np, rIrIo/np, rIrIomax, stt/np, sttmax);
+	fclose(fp);
+}
+
+// waits for the remaining workers (parent only) and writes the summary
+void FEMbeCmm::CollectScenarios()
+{
+	if (m_scenario != 0) return;
+
+	const double tnominal = GRWallTime() - m_tfanout;
+	int nrunning = 0;
+	for (size_t i = 0; i < m_workers.size(); i++) nrunning += (m_workers[i].done ? 0 : 1);
+	while ((nrunning-- > 0) && (WaitWorker(m_workers) >= 0));
+	const double ttotal = GRWallTime() - m_tfanout;
+
+	FILE* fp = fopen((m_fanoutOutput + "_summary.csv").c_str(), "wt");
+	if (fp) fprintf(fp, "scenario,pid,status,wall_s,cpu_s\n");
+
+	feLog("mbe_cmm scenarios (name, exit code, wall / cpu time [s] after the fan-out)\n");
+	feLog("\t%-20s %4s %10.3lf\n", "nominal", "-", tnominal);
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		const GRWorker& w = m_workers[i];
+		const char* szname = m_scenarios[w.scenario].name.c_str();
+		feLog("\t%-20s %4d %10.3lf %10.3lf\n", szname, w.status, w.twall, w.tcpu);
+		if (fp) fprintf(fp, "%s,%d,%d,%.3lf,%.3lf\n", szname, w.pid, w.status, w.twall, w.tcpu);
+		if (w.status != 0) feLogWarning("mbe_cmm: scenario %s did not terminate normally\n", szname);
+	}
+	feLog("\t%d scenarios in %.3lf s\n", (int) m_workers.size() + 1, ttotal);
+	if (fp) fclose(fp);
+}
@@ -0,0 +1,53 @@
+#include "FEMbeCmmPlot.h"
+#include "FEMbeCmm.h"
+#include "FECore/FEDomain.h"
+
+// writes the element averages of a quantity of the G&R material points of a domain.
+// returns false for domains of other materials.
+template <class T>
+static bool WriteGRElementAverage(FEDomain& dom, FEDataStream& a, T value)
+{
+	if (dynamic_cast<FEMbeCmm*>(dom.GetMaterial()) == nullptr) return false;
+
+	for (int i = 0; i < dom.Elements(); i++)
+	{
+		FEElement& el = dom.ElementRef(i);
+		const int nint = el.GaussPoints();
+
+		double v = 0.0;
+		for (int n = 0; n < nint; n++) v += value(*el.GetMaterialPoint(n)->ExtractData<GRMaterialPoint>());
+
+		a << v / nint;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FEPlotGRphic::Save(FEDomain& dom, FEDataStream& a)
+{
+	return WriteGRElementAverage(dom, a, [](const GRMaterialPoint& pt) { return pt.m_phicT; });
+}
+
+//-----------------------------------------------------------------------------
+bool FEPlotGRphim::Save(FEDomain& dom, FEDataStream& a)
+{
+	return WriteGRElementAverage(dom, a, [](const GRMaterialPoint& pt) { return (double) pt.m_phim; });
+}
+
+//-----------------------------------------------------------------------------
+bool FEPlotGRrIrIo::Save(FEDomain& dom, FEDataStream& a)
+{
+	return WriteGRElementAverage(dom, a, [](const GRMaterialPoint& pt) { return (double) pt.m_rIrIo; });
+}
+
+//-----------------------------------------------------------------------------
+bool FEPlotGRCircumferentialStress::Save(FEDomain& dom, FEDataStream& a)
+{
+	return WriteGRElementAverage(dom, a, [](const GRMaterialPoint& pt) { return (double) pt.m_stt; });
+}
+
+//-----------------------------------------------------------------------------
+bool FEPlotGRActiveRatio::Save(FEDomain& dom, FEDataStream& a)
+{
+	return WriteGRElementAverage(dom, a, [](const GRMaterialPoint& pt) { return (double) pt.m_act; });
+}
@@ -0,0 +1,52 @@
+#pragma once
+//=============================================================================
+// Plot variables of the G&R material (mbe_cmm). They are element averages of
+// the state stored at the integration points by the last material evaluation,
+// so writing them does not re-evaluate the constitutive model.
+//=============================================================================
+#include "FECore/FEPlotData.h"
+
+//-----------------------------------------------------------------------------
+//! total mass fraction of collagen
+class FEPlotGRphic : public FEPlotDomainData
+{
+public:
+	FEPlotGRphic(FEModel* pfem) : FEPlotDomainData(pfem, PLT_FLOAT, FMT_ITEM) {}
+	bool Save(FEDomain& dom, FEDataStream& a) override;
+};
+
+//-----------------------------------------------------------------------------
+//! mass fraction of smooth muscle cells
+class FEPlotGRphim : public FEPlotDomainData
+{
+public:
+	FEPlotGRphim(FEModel* pfem) : FEPlotDomainData(pfem, PLT_FLOAT, FMT_ITEM) {}
+	bool Save(FEDomain& dom, FEDataStream& a) override;
+};
+
+//-----------------------------------------------------------------------------
+//! inner radius relative to its homeostatic value
+class FEPlotGRrIrIo : public FEPlotDomainData
+{
+public:
+	FEPlotGRrIrIo(FEModel* pfem) : FEPlotDomainData(pfem, PLT_FLOAT, FMT_ITEM) {}
+	bool Save(FEDomain& dom, FEDataStream& a) override;
+};
+
+//-----------------------------------------------------------------------------
+//! circumferential Cauchy stress
+class FEPlotGRCircumferentialStress : public FEPlotDomainData
+{
+public:
+	FEPlotGRCircumferentialStress(FEModel* pfem) : FEPlotDomainData(pfem, PLT_FLOAT, FMT_ITEM) {}
+	bool Save(FEDomain& dom, FEDataStream& a) override;
+};
+
+//-----------------------------------------------------------------------------
+//! active tone relative to its homeostatic value
+class FEPlotGRActiveRatio : public FEPlotDomainData
+{
+public:
+	FEPlotGRActiveRatio(FEModel* pfem) : FEPlotDomainData(pfem, PLT_FLOAT, FMT_ITEM) {}
+	bool Save(FEDomain& dom, FEDataStream& a) override;
+};
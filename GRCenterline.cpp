@@ -0,0 +1,185 @@
+#include "GRCenterline.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+// maximum number of segments in a leaf of the hierarchy
+static const int GR_BVH_LEAF = 4;
+
+bool GRCenterline::Load(const char* szfile, std::string& err)
+{
+	FILE* fp = fopen(szfile, "rt");
+	if (fp == nullptr) { err = std::string("cannot open centerline file ") + szfile; return false; }
+
+	std::vector<vec3d> X;
+	std::vector<double> rIo;
+	char szline[1024];
+	int nline = 0;
+	while (fgets(szline, sizeof(szline), fp))
+	{
+		nline++;
+		char* ch = strchr(szline, '#');
+		if (ch) *ch = 0;
+
+		double x, y, z, r;
+		const int n = sscanf(szline, "%lg %lg %lg %lg", &x, &y, &z, &r);
+		if (n <= 0) continue;
+		if ((n != 4) || (r <= 0.0)) {
+			char sz[64]; snprintf(sz, sizeof(sz), "invalid node in line %d of ", nline);
+			err = std::string(sz) + szfile;
+			fclose(fp);
+			return false;
+		}
+		// merge a node that repeats the previous one (a zero length segment has no tangent)
+		const vec3d Xn(x, y, z);
+		if (!X.empty()) {
+			const vec3d dX = Xn - X.back();
+			if (dX*dX <= 1e-24*std::max(Xn*Xn, 1.0)) continue;
+		}
+		X.push_back(Xn);
+		rIo.push_back(r);
+	}
+	fclose(fp);
+
+	if (X.size() < 2) { err = std::string("less than two distinct nodes in centerline file ") + szfile; return false; }
+
+	Build(X, rIo);
+	return true;
+}
+
+void GRCenterline::Build(const std::vector<vec3d>& X, const std::vector<double>& rIo)
+{
+	m_X = X;
+	m_rIo = rIo;
+	m_seg.clear();
+	m_tree.clear();
+	m_T.clear();
+	if (Empty()) return;
+
+	// nodal tangents from the adjacent segments (central differences inside)
+	const int N = (int) m_X.size();
+	m_T.resize(N);
+	for (int i = 0; i < N; i++)
+	{
+		vec3d t = m_X[std::min(i + 1, N - 1)] - m_X[std::max(i - 1, 0)];
+		m_T[i] = t/sqrt(t*t);
+	}
+
+	m_seg.resize(N - 1);
+	for (int i = 0; i < N - 1; i++) m_seg[i] = i;
+	m_tree.reserve(2*(N - 1)/GR_BVH_LEAF + 1);
+	BuildNode(0, N - 1);
+}
+
+// builds the subtree of the segments m_seg[first, first + count) by a median split
+// of the segment midpoints along the longest axis of their bounding box
+int GRCenterline::BuildNode(int first, int count)
+{
+	const int inode = (int) m_tree.size();
+	m_tree.push_back(Node());
+
+	Node nd;
+	nd.bmin = nd.bmax = m_X[m_seg[first]];
+	vec3d cmin(m_X[m_seg[first]]), cmax(cmin);
+	for (int i = first; i < first + count; i++)
+	{
+		const vec3d& a = m_X[m_seg[i]];
+		const vec3d& b = m_X[m_seg[i] + 1];
+		const vec3d c = (a + b)*0.5;
+		nd.bmin = vec3d(std::min(nd.bmin.x, std::min(a.x, b.x)), std::min(nd.bmin.y, std::min(a.y, b.y)), std::min(nd.bmin.z, std::min(a.z, b.z)));
+		nd.bmax = vec3d(std::max(nd.bmax.x, std::max(a.x, b.x)), std::max(nd.bmax.y, std::max(a.y, b.y)), std::max(nd.bmax.z, std::max(a.z, b.z)));
+		cmin = vec3d(std::min(cmin.x, c.x), std::min(cmin.y, c.y), std::min(cmin.z, c.z));
+		cmax = vec3d(std::max(cmax.x, c.x), std::max(cmax.y, c.y), std::max(cmax.z, c.z));
+	}
+
+	if (count <= GR_BVH_LEAF) {
+		nd.left = nd.right = -1;
+		nd.first = first;
+		nd.count = count;
+	}
+	else {
+		const vec3d d = cmax - cmin;
+		const int axis = (d.x >= d.y && d.x >= d.z ? 0 : (d.y >= d.z ? 1 : 2));
+		const std::vector<vec3d>& Xn = m_X;
+		std::nth_element(m_seg.begin() + first, m_seg.begin() + first + count/2, m_seg.begin() + first + count,
+			[&Xn, axis](int i, int j) {
+				const vec3d ci = Xn[i] + Xn[i + 1], cj = Xn[j] + Xn[j + 1];
+				return (axis == 0 ? ci.x < cj.x : (axis == 1 ? ci.y < cj.y : ci.z < cj.z));
+			});
+
+		nd.first = first;
+		nd.count = 0;
+		nd.left = BuildNode(first, count/2);
+		nd.right = BuildNode(first + count/2, count - count/2);
+	}
+
+	m_tree[inode] = nd;
+	return inode;
+}
+
+// squared distance of X to a bounding box
+static inline double BoxDistance2(const vec3d& X, const vec3d& bmin, const vec3d& bmax)
+{
+	const double dx = std::max(std::max(bmin.x - X.x, X.x - bmax.x), 0.0);
+	const double dy = std::max(std::max(bmin.y - X.y, X.y - bmax.y), 0.0);
+	const double dz = std::max(std::max(bmin.z - X.z, X.z - bmax.z), 0.0);
+	return dx*dx + dy*dy + dz*dz;
+}
+
+// updates cp if segment iseg is closer to X
+void GRCenterline::NearestSegment(int iseg, const vec3d& X, GRCenterlinePoint& cp) const
+{
+	const vec3d& a = m_X[iseg];
+	const vec3d ab = m_X[iseg + 1] - a;
+	const double l2 = ab*ab;
+	double s = (l2 > 0.0 ? ((X - a)*ab)/l2 : 0.0);
+	s = std::min(std::max(s, 0.0), 1.0);
+
+	const vec3d Xc = a + ab*s;
+	const vec3d d = X - Xc;
+	const double d2 = d*d;
+	if (d2 >= cp.dist2) return;
+
+	const vec3d t = m_T[iseg]*(1.0 - s) + m_T[iseg + 1]*s;
+	cp.X = Xc;
+	cp.T = t/sqrt(t*t);
+	cp.rIo = m_rIo[iseg]*(1.0 - s) + m_rIo[iseg + 1]*s;
+	cp.dist2 = d2;
+}
+
+GRCenterlinePoint GRCenterline::Nearest(const vec3d& X) const
+{
+	GRCenterlinePoint cp;
+	cp.rIo = 0.0;
+	cp.dist2 = std::numeric_limits<double>::max();
+	if (Empty()) return cp;
+
+	// depth first, nearer child first, skipping subtrees farther than the best segment so far
+	int stack[64];
+	int nstack = 0;
+	stack[nstack++] = 0;
+	while (nstack > 0)
+	{
+		const Node& nd = m_tree[stack[--nstack]];
+		if (BoxDistance2(X, nd.bmin, nd.bmax) >= cp.dist2) continue;
+
+		if (nd.left < 0) {
+			for (int i = nd.first; i < nd.first + nd.count; i++) NearestSegment(m_seg[i], X, cp);
+			continue;
+		}
+
+		const Node& l = m_tree[nd.left];
+		const Node& r = m_tree[nd.right];
+		if (BoxDistance2(X, l.bmin, l.bmax) < BoxDistance2(X, r.bmin, r.bmax)) {
+			stack[nstack++] = nd.right;
+			stack[nstack++] = nd.left;
+		}
+		else {
+			stack[nstack++] = nd.left;
+			stack[nstack++] = nd.right;
+		}
+	}
+
+	return cp;
+}
@@ -0,0 +1,60 @@
+#pragma once
+//=============================================================================
+// Discretised vessel centerline with a varying reference inner radius, for
+// geometries that are not described by the analytic center line of the
+// material (mbe_cmm). Segments are indexed by a bounding volume hierarchy, so
+// the nearest centerline point of a material point is found in O(log n).
+//=============================================================================
+#include "FECore/vec3d.h"
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+//! result of a nearest point query
+struct GRCenterlinePoint
+{
+	vec3d		X;			//!< nearest point on the centerline
+	vec3d		T;			//!< unit tangent, interpolated between the nodal tangents
+	double		rIo;		//!< reference inner radius, interpolated between the nodes
+	double		dist2;		//!< squared distance to the query point
+};
+
+//-----------------------------------------------------------------------------
+class GRCenterline
+{
+public:
+	GRCenterline() {}
+
+	// reads the centerline nodes in order, one line per node with x y z rIo ('#' starts a comment),
+	// and builds the segment index. A node at the position of the previous one is dropped.
+	// returns false (with a message in err) for invalid files.
+	bool Load(const char* szfile, std::string& err);
+
+	// sets the centerline nodes and builds the segment index (at least two nodes)
+	void Build(const std::vector<vec3d>& X, const std::vector<double>& rIo);
+
+	bool Empty() const { return m_X.size() < 2; }
+	int Nodes() const { return (int) m_X.size(); }
+
+	// nearest point of the centerline to X
+	GRCenterlinePoint Nearest(const vec3d& X) const;
+
+private:
+	struct Node
+	{
+		vec3d	bmin, bmax;		//!< bounding box of the segments of the subtree
+		int		left, right;	//!< child nodes (-1 for leaves)
+		int		first, count;	//!< range in m_seg of the segments of a leaf
+	};
+
+	int BuildNode(int first, int count);
+
+	void NearestSegment(int iseg, const vec3d& X, GRCenterlinePoint& cp) const;
+
+private:
+	std::vector<vec3d>	m_X;		//!< nodes
+	std::vector<vec3d>	m_T;		//!< nodal unit tangents
+	std::vector<double>	m_rIo;		//!< nodal reference inner radii
+	std::vector<int>	m_seg;		//!< segment indices (segment i connects nodes i and i+1), in tree order
+	std::vector<Node>	m_tree;		//!< hierarchy, root first
+};
@@ -0,0 +1,108 @@
+#pragma once
+//=============================================================================
+// Elementary functions of the material (mbe_cmm) that can be vectorized: the
+// scalar versions have no branches or table lookups, so loops over them
+// compile to SIMD code under omp simd. Error bounds (relative to the exact
+// result, measured against libm by bench -accuracy, see bench.sh):
+//   gr_exp(x)    : < 2.5e-16 for -708 <= x <= 709 (x is clamped to this range)
+//   gr_log(x)    : < 2.5e-16 for normal x > 0 (absolute error < 1.2e-16 near x = 1)
+//   gr_pow(x, y) : < (2 + 2*|y*log(x)|)*1.2e-16 for normal x > 0
+// Define GR_LIBM_MATH to forward to libm instead (used as the accuracy reference).
+//=============================================================================
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef GR_LIBM_MATH
+
+inline double gr_exp(double x) { return exp(x); }
+inline double gr_log(double x) { return log(x); }
+inline double gr_pow(double x, double y) { return pow(x, y); }
+
+#else
+
+// exp(x) = 2^k*exp(r), with k = round(x/ln2) and |r| <= ln2/2, exp(r) from its Taylor series
+inline double gr_exp(double x)
+{
+	const double ln2hi  = 6.93147180369123816490e-01;		// ln2 = ln2hi + ln2lo, ln2hi*k is exact
+	const double ln2lo  = 1.90821492927058770002e-10;
+	const double log2e  = 1.44269504088896338700e+00;
+	const double shift  = 6755399441055744.0;				// 1.5*2^52, rounds to the nearest integer when added
+
+	x = std::min(std::max(x, -708.0), 709.0);
+
+	const double kd = (x*log2e + shift) - shift;
+	const double r  = (x - kd*ln2hi) - kd*ln2lo;
+
+	double p = 1.0/6227020800.0;							// 1/13!
+	p = p*r + 1.0/479001600.0;
+	p = p*r + 1.0/39916800.0;
+	p = p*r + 1.0/3628800.0;
+	p = p*r + 1.0/362880.0;
+	p = p*r + 1.0/40320.0;
+	p = p*r + 1.0/5040.0;
+	p = p*r + 1.0/720.0;
+	p = p*r + 1.0/120.0;
+	p = p*r + 1.0/24.0;
+	p = p*r + 1.0/6.0;
+	p = p*r + 0.5;
+	p = p*r*r + r;
+
+	// 2^k from the integer in the low mantissa bits of kd + shift + 1023
+	const double b = kd + (shift + 1023.0);
+	uint64_t bits;
+	memcpy(&bits, &b, sizeof(bits));
+	bits <<= 52;
+	double s;
+	memcpy(&s, &bits, sizeof(s));
+
+	return s + s*p;
+}
+
+// log(x) = e*ln2 + log(m), with x = m*2^e, sqrt(1/2) <= m < sqrt(2), log(m) = 2*atanh((m-1)/(m+1)) from its series
+inline double gr_log(double x)
+{
+	const double ln2hi = 6.93147180369123816490e-01;
+	const double ln2lo = 1.90821492927058770002e-10;
+
+	uint64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	double e = (double) (int64_t) (bits >> 52) - 1023.0;
+	bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+	double m;
+	memcpy(&m, &bits, sizeof(m));
+
+	const bool bhalf = (m > 1.41421356237309504880);
+	m = (bhalf ? 0.5*m : m);
+	e = (bhalf ? e + 1.0 : e);
+
+	const double f  = m - 1.0;
+	const double s  = f/(m + 1.0);
+	const double s2 = s*s;
+
+	double p = 1.0/21.0;
+	p = p*s2 + 1.0/19.0;
+	p = p*s2 + 1.0/17.0;
+	p = p*s2 + 1.0/15.0;
+	p = p*s2 + 1.0/13.0;
+	p = p*s2 + 1.0/11.0;
+	p = p*s2 + 1.0/9.0;
+	p = p*s2 + 1.0/7.0;
+	p = p*s2 + 1.0/5.0;
+	p = p*s2 + 1.0/3.0;
+
+	// 2*s = f - s*f, which keeps the leading term exact for m close to 1
+	return e*ln2hi + ((f - s*(f - 2.0*s2*p)) + e*ln2lo);
+}
+
+inline double gr_pow(double x, double y) { return gr_exp(y*gr_log(x)); }
+
+#endif
+
+// y[i] = exp(x[i]) for n values
+inline void gr_exp(const double* x, double* y, const int n)
+{
+	#pragma omp simd
+	for (int i = 0; i < n; i++) y[i] = gr_exp(x[i]);
+}
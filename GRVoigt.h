@@ -0,0 +1,103 @@
+#pragma once
+//=============================================================================
+// Fused accumulation of spatial tangents with minor symmetries in Voigt form
+// (order xx, yy, zz, xy, yz, xz, tensor components). The contributions of the
+// material (mbe_cmm) are added as scaled dyadic products directly into one
+// 6x6 buffer, instead of building a tens4dmm temporary per term, and the
+// identity tensors are applied from their known sparsity.
+//=============================================================================
+#include "FECore/tens4d.h"
+
+//-----------------------------------------------------------------------------
+//! second-order symmetric tensor in Voigt order
+struct GRVoigtVec
+{
+	double v[6];
+
+	GRVoigtVec() {}
+	GRVoigtVec(const mat3ds& a) { v[0] = a.xx(); v[1] = a.yy(); v[2] = a.zz(); v[3] = a.xy(); v[4] = a.yz(); v[5] = a.xz(); }
+};
+
+//-----------------------------------------------------------------------------
+class GRVoigt
+{
+public:
+	GRVoigt() { Zero(); }
+
+	void Zero()
+	{
+		#pragma omp simd
+		for (int i = 0; i < 36; i++) d[i] = 0.0;
+	}
+
+	// += s*(a x b)
+	void Dyad(double s, const GRVoigtVec& a, const GRVoigtVec& b)
+	{
+		for (int I = 0; I < 6; I++)
+		{
+			const double sa = s*a.v[I];
+			#pragma omp simd
+			for (int J = 0; J < 6; J++) d[6*I + J] += sa*b.v[J];
+		}
+	}
+
+	// += s*(a x a)
+	void Dyad(double s, const GRVoigtVec& a) { Dyad(s, a, a); }
+
+	// += s*(I x b)
+	void IxB(double s, const GRVoigtVec& b)
+	{
+		for (int I = 0; I < 3; I++)
+		{
+			#pragma omp simd
+			for (int J = 0; J < 6; J++) d[6*I + J] += s*b.v[J];
+		}
+	}
+
+	// += s*(a x I)
+	void AxI(double s, const GRVoigtVec& a)
+	{
+		for (int I = 0; I < 6; I++)
+		{
+			const double sa = s*a.v[I];
+			d[6*I] += sa; d[6*I + 1] += sa; d[6*I + 2] += sa;
+		}
+	}
+
+	// += s*(I x I)
+	void IxI(double s)
+	{
+		for (int I = 0; I < 3; I++) { d[6*I] += s; d[6*I + 1] += s; d[6*I + 2] += s; }
+	}
+
+	// += s*(I o I), the symmetric fourth-order identity
+	void IoI(double s)
+	{
+		d[ 0] += s; d[ 7] += s; d[14] += s;
+		d[21] += 0.5*s; d[28] += 0.5*s; d[35] += 0.5*s;
+	}
+
+	// in place c -= 1/3*(I x I):c, the deviatoric projection from the left
+	void DevLeft()
+	{
+		double tr[6];
+		#pragma omp simd
+		for (int J = 0; J < 6; J++) tr[J] = (d[J] + d[6 + J] + d[12 + J])/3.0;
+		for (int I = 0; I < 3; I++)
+		{
+			#pragma omp simd
+			for (int J = 0; J < 6; J++) d[6*I + J] -= tr[J];
+		}
+	}
+
+	tens4dmm Tens4dmm() const
+	{
+		double m[6][6];
+		for (int I = 0; I < 6; I++)
+			for (int J = 0; J < 6; J++) m[I][J] = d[6*I + J];
+		return tens4dmm(m);
+	}
+
+private:
+	alignas(32) double d[36];	//!< row major, d[6*I + J] = c(I,J)
+};
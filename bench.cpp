@@ -0,0 +1,670 @@
+// Standalone micro-benchmark of the FEMbeCmm constitutive evaluation.
+// Evaluates the material on synthetic deformation gradients and positions of a
+// cylindrical segment for the prestress (t <= 1) and G&R (t > 1) branches, without
+// assembly or linear solver. Reports ns/point for stress only and for stress and
+// tangent, and compares with a stored baseline file.
+// The accuracy modes check the math layer (GRMath.h) against libm, directly and through the
+// material response on sampled deformation states (see bench.sh -accuracy).
+// The check mode compares the evaluation paths of the material with each other on the bench points.
+// The scaling mode measures the throughput of parallel element loops over the integration points
+// of the TAA mesh and of a larger generated axisymmetric mesh at 1 to N threads.
+//
+// usage: bench [-n points] [-r repeats] [-b baseline] [-save] [-p name value ...] [-dump file | -accuracy file | -check]
+//        bench -scaling [-threads N] [-mesh file] [-axi nr nt nz] [-r repeats] [-p name value ...]
+//   -n         number of material points (default 4096)
+//   -r         number of passes over all points per case (default 20)
+//   -b         baseline file (default bench_baseline.txt)
+//   -save      write the measured timings to the baseline file
+//   -p         set a double material parameter (e.g. -p Tmax 250)
+//   -dump      write the stresses and tangents of the sampled states to file (reference, from a GR_LIBM_MATH build)
+//   -accuracy  compare the elementary functions with libm and the sampled states with the reference file
+//   -check     stress-only path against the stress and tangent path, tangent against finite differences,
+//              spectral decomposition against the polar decomposition path (also part of -accuracy)
+//   -scaling   thread scaling of the stress and tangent evaluation (default 3 repeats)
+//   -threads   largest number of threads (default: number of cores)
+//   -mesh      FEBio input file with the hex8 mesh (default TAA-axi-4x200x1L-ht.feb)
+//   -axi       radial, circumferential and axial elements of the generated mesh (default 4 64 50)
+#include "FEMbeCmm.h"
+#include "GRMath.h"
+#include "FECore/FEModel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <random>
+#include <string>
+#include <vector>
+
+// deformation gradient of a distended, slightly twisted cylinder at time t, with a
+// point dependent perturbation pert
+static mat3d SyntheticF(const vec3d& X, double t, double pert)
+{
+	const double r  = sqrt(X.x*X.x + X.y*X.y);
+	const double th = atan2(X.y, X.x);
+	const vec3d er(cos(th), sin(th), 0.0), et(-sin(th), cos(th), 0.0), ez(0.0, 0.0, 1.0);
+
+	const double s  = (t <= 1.0 ? t : 1.0 + 0.03*(t - 1.0));
+	const double lt = 1.0 + 0.15*s + 0.01*(r - 0.65) + pert;
+	const double lz = 1.0 + 0.05*s - 0.3*pert;
+	const double lr = 1.0/(lt*lz)*(1.0 + 0.002*s + 0.5*pert);
+	const double g  = 0.02*s*sin(X.z) + pert;
+
+	const mat3d U = (er & er)*lr + (et & et)*lt + (ez & ez)*lz + (et & ez)*g + (er & et)*(0.5*g);
+
+	const double a = 0.05*s + 2.0*pert;
+	const mat3d Q(cos(a), -sin(a), 0.0, sin(a), cos(a), 0.0, 0.0, 0.0, 1.0);
+
+	return Q*U;
+}
+
+static void SetDeformation(std::vector<FEMaterialPoint*>& mp, double t, double pert)
+{
+	for (size_t n = 0; n < mp.size(); n++) {
+		FEElasticMaterialPoint& ep = *mp[n]->ExtractData<FEElasticMaterialPoint>();
+		ep.m_F = SyntheticF(mp[n]->m_r0, t, (n % 2 ? pert : -pert));
+		ep.m_J = ep.m_F.det();
+	}
+}
+
+// returns the time per point in ns of nrep passes over all points
+static double TimeCase(FEMbeCmm& mat, std::vector<FEMaterialPoint*>& mp, int nrep, bool tangent)
+{
+	double chk = 0.0;
+	const auto t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < nrep; r++) {
+		for (size_t n = 0; n < mp.size(); n++) {
+			if (tangent) chk += mat.SecantTangent(*mp[n])(0,0,0,0);
+			else chk += mat.Stress(*mp[n]).xx();
+		}
+	}
+	const auto t1 = std::chrono::steady_clock::now();
+
+	// keeps the evaluations from being optimized away
+	if (chk != chk) printf("warning: NaN in results\n");
+
+	return std::chrono::duration<double, std::nano>(t1 - t0).count()/((double) nrep*mp.size());
+}
+
+// stress and tangent (in Voigt order) of all points on a fixed prestress and G&R history
+static void SampleStates(FEMbeCmm& mat, std::vector<FEMaterialPoint*>& mp, std::vector<double>& res)
+{
+	static const int vi[6] = {0, 1, 2, 0, 1, 0}, vj[6] = {0, 1, 2, 1, 2, 2};
+	const double times[] = {0.5, 1.0, 3.0, 7.0, 11.0};
+	const double perts[] = {0.01, -0.02, 0.0};
+
+	FETimeInfo& tp = mat.GetFEModel()->GetTime();
+	res.clear();
+	for (double t : times)
+	{
+		tp.currentTime = t;
+		for (size_t n = 0; n < mp.size(); n++) mp[n]->Update(tp);
+
+		// the last perturbation is the converged state of the step
+		for (double pert : perts)
+		{
+			SetDeformation(mp, t, pert);
+			for (size_t n = 0; n < mp.size(); n++)
+			{
+				const mat3ds s = mat.Stress(*mp[n]);
+				const tens4dmm c = mat.SecantTangent(*mp[n]);
+				for (int I = 0; I < 6; I++) res.push_back(s(vi[I], vj[I]));
+				for (int I = 0; I < 6; I++)
+					for (int J = 0; J < 6; J++) res.push_back(c(vi[I], vj[I], vi[J], vj[J]));
+			}
+		}
+	}
+}
+
+// stress of the stress-only path (Stress) against the stress of the stress and tangent path on a fixed
+// prestress and G&R history; the paths share the stress code, so they must agree exactly
+static bool CheckStressOnly(FEMbeCmm& mat, std::vector<FEMaterialPoint*>& mp)
+{
+	const double times[] = {0.5, 1.0, 3.0, 7.0, 11.0};
+	const double perts[] = {0.01, 0.0};
+
+	FETimeInfo& tp = mat.GetFEModel()->GetTime();
+	double err = 0.0;
+	long ndiff = 0, ntot = 0;
+	for (double t : times)
+	{
+		tp.currentTime = t;
+		for (size_t n = 0; n < mp.size(); n++) mp[n]->Update(tp);
+
+		for (double pert : perts)
+		{
+			SetDeformation(mp, t, pert);
+			for (size_t n = 0; n < mp.size(); n++)
+			{
+				const mat3ds s0 = mat.Stress(*mp[n]);
+				mat3ds s1; tens4dmm c;
+				mat.StressTangent(*mp[n], s1, &c);
+				const double d = (s1 - s0).norm();
+				err = std::max(err, d/std::max(s1.norm(), 1e-300));
+				ndiff += (d != 0.0 ? 1 : 0);
+				ntot++;
+			}
+		}
+	}
+
+	printf("%-26s %12.3g %12.3g   (%ld of %ld differ)\n", "stress-only path", err, 0.0, ndiff, ntot);
+	return (ndiff == 0);
+}
+
+// Kirchhoff stress J*s at the deformation gradient F
+static mat3ds Kirchhoff(FEMbeCmm& mat, FEMaterialPoint& mp, const mat3d& F)
+{
+	FEElasticMaterialPoint& ep = *mp.ExtractData<FEElasticMaterialPoint>();
+	ep.m_F = F;
+	ep.m_J = F.det();
+	return mat.Stress(mp)*ep.m_J;
+}
+
+// spatial tangent against central differences of the Kirchhoff stress tau. For F(h) = (I + h*A)*F with
+// symmetric A, the Truesdell rate gives J*c:A = d(tau)/dh - A*tau - tau*A, which is compared with the
+// tangent for A = sym(ek x el) on a subset of the points, in the prestress (t = 1) and G&R (t = 5) branches
+static bool CheckTangentFD(FEMbeCmm& mat, std::vector<FEMaterialPoint*>& mp)
+{
+	static const int vi[6] = {0, 1, 2, 0, 1, 0}, vj[6] = {0, 1, 2, 1, 2, 2};
+	const double h = 1e-6;
+	const double tol = 1e-6;
+	const size_t stride = std::max(mp.size()/64, (size_t) 1);
+
+	FETimeInfo& tp = mat.GetFEModel()->GetTime();
+	double err[2] = {0.0, 0.0};
+	const double times[] = {0.5, 1.0, 5.0};
+	for (double t : times)
+	{
+		tp.currentTime = t;
+		for (size_t n = 0; n < mp.size(); n++) mp[n]->Update(tp);
+
+		// converged state of the step (the history of the next one)
+		SetDeformation(mp, t, 0.0);
+		for (size_t n = 0; n < mp.size(); n++) mat.Stress(*mp[n]);
+		if (t < 1.0) continue;
+
+		SetDeformation(mp, t, 0.005);
+		const int ib = (t <= 1.0 ? 0 : 1);
+		for (size_t n = 0; n < mp.size(); n += stride)
+		{
+			FEElasticMaterialPoint& ep = *mp[n]->ExtractData<FEElasticMaterialPoint>();
+			const mat3d F = ep.m_F;
+			const double J = F.det();
+
+			mat3ds s; tens4dmm c;
+			mat.StressTangent(*mp[n], s, &c);
+			const mat3ds tau = s*J;
+
+			double cmax = 0.0, dmax = 0.0;
+			for (int K = 0; K < 6; K++)
+			{
+				mat3d A; A.zero();
+				A(vi[K], vj[K]) += 0.5; A(vj[K], vi[K]) += 0.5;
+				const mat3ds As = A.sym();
+
+				const mat3d I(1, 0, 0, 0, 1, 0, 0, 0, 1);
+				const mat3ds dtau = (Kirchhoff(mat, *mp[n], (I + A*h)*F) - Kirchhoff(mat, *mp[n], (I - A*h)*F))/(2.0*h);
+				const mat3ds cA = (dtau - (As*tau + tau*As).sym())/J;
+
+				for (int I2 = 0; I2 < 6; I2++) {
+					const double ca = c(vi[I2], vj[I2], vi[K], vj[K]);
+					cmax = std::max(cmax, fabs(ca));
+					dmax = std::max(dmax, fabs(ca - cA(vi[I2], vj[I2])));
+				}
+			}
+			err[ib] = std::max(err[ib], dmax/cmax);
+
+			// back to the state of the step
+			ep.m_F = F;
+			ep.m_J = J;
+			mat.Stress(*mp[n]);
+		}
+	}
+
+	printf("%-26s %12.3g %12.3g\n", "tangent FD (prestress)", err[0], tol);
+	printf("%-26s %12.3g %12.3g\n", "tangent FD (G&R)", err[1], tol);
+	return (err[0] <= tol) && (err[1] <= tol);
+}
+
+// rotation by angle a about the axis n
+static mat3d Rotation(vec3d n, double a)
+{
+	n.unit();
+	const mat3d I(1, 0, 0, 0, 1, 0, 0, 0, 1);
+	const mat3d K(0, -n.z, n.y, n.z, 0, -n.x, -n.y, n.x, 0);
+	return I + K*sin(a) + (K*K)*(1.0 - cos(a));
+}
+
+// Frobenius norm
+static double Norm(const mat3d& A)
+{
+	double s = 0.0;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++) s += A(i,j)*A(i,j);
+	return sqrt(s);
+}
+
+// GRSpectralDecomposition against the separate evaluation it replaced (F.right_polar for R and U,
+// inverses of C and U), and the residuals U*U = C, R*U = F, Rt*R = I, on rotated principal stretches
+// with distinct, repeated (undeformed, axisymmetric) and near-repeated values
+static bool CheckSpectral()
+{
+	const double tol = 1e-12;
+	std::mt19937_64 rng(2);
+	std::uniform_real_distribution<double> ua(-M_PI, M_PI), un(-1.0, 1.0), ul(0.6, 1.6);
+	const mat3d I(1, 0, 0, 0, 1, 0, 0, 0, 1);
+
+	double eref = 0.0, eres = 0.0;
+	for (int i = 0; i < 20000; i++)
+	{
+		// principal stretches: distinct, undeformed, two or three repeated, two nearly repeated
+		double l[3] = {ul(rng), ul(rng), ul(rng)};
+		const int kind = i % 6;
+		const double d = pow(10.0, -4.0 - (i/6) % 10);
+		if (kind == 1) l[0] = l[1] = l[2] = 1.0;
+		if (kind == 2) l[1] = l[0];
+		if (kind == 3) l[1] = l[2] = l[0];
+		if (kind == 4) l[1] = l[0]*(1.0 + d);
+		if (kind == 5) { l[1] = l[0]*(1.0 + d); l[2] = l[0]*(1.0 - d); }
+
+		const mat3d Q = Rotation(vec3d(un(rng), un(rng), un(rng)), ua(rng));
+		const mat3d P = (i % 12 == 1 ? I : Rotation(vec3d(un(rng), un(rng), un(rng)), ua(rng)));
+		const mat3d D(l[0], 0, 0, 0, l[1], 0, 0, 0, l[2]);
+		const mat3d F = Q*P*D*P.transpose();
+
+		GRSpectral sd;
+		GRSpectralDecomposition(F, sd);
+
+		mat3ds U; mat3d R;
+		F.right_polar(R, U);
+		const mat3ds C = (F.transpose()*F).sym();
+		const mat3ds Ci = C.inverse();
+		const mat3ds Ui = U.inverse();
+
+		eref = std::max(eref, (sd.U - U).norm()/U.norm());
+		eref = std::max(eref, (sd.Ui - Ui).norm()/Ui.norm());
+		eref = std::max(eref, (sd.Ci - Ci).norm()/Ci.norm());
+		eref = std::max(eref, (sd.C - C).norm()/C.norm());
+		eref = std::max(eref, Norm(sd.R - R)/sqrt(3.0));
+
+		eres = std::max(eres, ((sd.U*sd.U).sym() - sd.C).norm()/sd.C.norm());
+		eres = std::max(eres, Norm(sd.R*mat3d(sd.U) - F)/Norm(F));
+		eres = std::max(eres, Norm(sd.R.transpose()*sd.R - I)/sqrt(3.0));
+		eres = std::max(eres, Norm((sd.U*sd.Ui) - I)/sqrt(3.0));
+	}
+
+	printf("%-26s %12.3g %12.3g\n", "spectral vs polar path", eref, tol);
+	printf("%-26s %12.3g %12.3g\n", "spectral residuals", eres, tol);
+	return (eref <= tol) && (eres <= tol);
+}
+
+// maximum relative errors of the elementary functions against libm on arguments that cover
+// the fiber laws, volume ratios and exponents of the material; returns false if a bound is exceeded
+static bool CheckMath()
+{
+	std::mt19937_64 rng(1);
+	std::uniform_real_distribution<double> ux(-50.0, 50.0), ul(-30.0, 30.0), ub(0.2, 5.0), ue(-4.0, 4.0);
+
+	double eexp = 0.0, elog = 0.0, epow = 0.0;
+	for (int i = 0; i < 1000000; i++)
+	{
+		const double x = ux(rng);
+		eexp = std::max(eexp, fabs(gr_exp(x) - exp(x))/exp(x));
+
+		const double y = exp(ul(rng));
+		if (y != 1.0) elog = std::max(elog, fabs(gr_log(y) - log(y))/fabs(log(y)));
+
+		// relative to the bound (2 + 2*|e*log(b)|)*1.2e-16, see GRMath.h
+		const double b = ub(rng), e = ue(rng), p = pow(b, e);
+		epow = std::max(epow, fabs(gr_pow(b, e) - p)/p/(2.0 + 2.0*fabs(e*log(b))));
+	}
+
+	// the bounds of GRMath.h, plus 0.5 ulp for the error of libm itself
+	printf("%-26s %12.3g %12.3g\n", "exp", eexp, 3.1e-16);
+	printf("%-26s %12.3g %12.3g\n", "log", elog, 3.1e-16);
+	printf("%-26s %12.3g %12.3g\n", "pow (relative to bound)", epow/1.2e-16, 1.5);
+	return (eexp <= 3.1e-16) && (elog <= 3.1e-16) && (epow/1.2e-16 <= 1.5);
+}
+
+// hex8 mesh: node coordinates and the 8 nodes (0-based) of each element
+struct BenchMesh
+{
+	std::vector<vec3d>	X;
+	std::vector<int>	el;
+	int Elements() const { return (int) el.size()/8; }
+};
+
+// reads the nodes and hex8 elements of an FEBio input file
+static bool ReadFebMesh(const char* szfile, BenchMesh& m)
+{
+	FILE* fp = fopen(szfile, "rt");
+	if (fp == nullptr) return false;
+
+	std::vector<int> ids;
+	std::vector<int> el;
+	char szline[1024];
+	while (fgets(szline, sizeof(szline), fp))
+	{
+		int id, n[8];
+		double x, y, z;
+		const char* ch = strchr(szline, '>');
+		if (ch == nullptr) continue;
+		if ((sscanf(szline, " <node id=\"%d\">", &id) == 1) && (sscanf(ch + 1, "%lf , %lf , %lf", &x, &y, &z) == 3)) {
+			if (id >= (int) ids.size()) ids.resize(id + 1, -1);
+			ids[id] = (int) m.X.size();
+			m.X.push_back(vec3d(x, y, z));
+		}
+		else if ((sscanf(szline, " <elem id=\"%d\">", &id) == 1) &&
+			(sscanf(ch + 1, "%d , %d , %d , %d , %d , %d , %d , %d", n, n+1, n+2, n+3, n+4, n+5, n+6, n+7) == 8))
+			el.insert(el.end(), n, n + 8);
+	}
+	fclose(fp);
+
+	m.el.resize(el.size());
+	for (size_t i = 0; i < el.size(); i++) {
+		if ((el[i] < 0) || (el[i] >= (int) ids.size()) || (ids[el[i]] < 0)) return false;
+		m.el[i] = ids[el[i]];
+	}
+	return (m.Elements() > 0);
+}
+
+// closed cylinder of the reference geometry (rIo = 0.6468, thickness 0.0402, length 30) with
+// nr x nt x nz elements, numbered like the TAA mesh (radial, then circumferential, then axial)
+static void AxisymmetricMesh(int nr, int nt, int nz, BenchMesh& m)
+{
+	const double ri = 0.6468, h = 0.0402, L = 30.0;
+	for (int k = 0; k <= nz; k++)
+		for (int j = 0; j < nt; j++)
+			for (int i = 0; i <= nr; i++) {
+				const double r = ri + h*i/nr, th = 2.0*M_PI*j/nt;
+				m.X.push_back(vec3d(r*cos(th), r*sin(th), L*k/nz));
+			}
+
+	const int nl = nt*(nr + 1);
+	for (int k = 0; k < nz; k++)
+		for (int j = 0; j < nt; j++)
+			for (int i = 0; i < nr; i++) {
+				const int a = k*nl + j*(nr + 1) + i, b = k*nl + ((j + 1) % nt)*(nr + 1) + i;
+				const int n[8] = {a, a + 1, b + 1, b, a + nl, a + nl + 1, b + nl + 1, b + nl};
+				m.el.insert(m.el.end(), n, n + 8);
+			}
+}
+
+// stress and tangent of all points (8 per element) in a parallel element loop on nthreads threads,
+// like the element loops of FEBio. returns the time per point in ns, res holds a check value per point
+static double TimeParallel(FEMbeCmm& mat, std::vector<FEMaterialPoint*>& mp, int nthreads, int nrep, std::vector<double>& res)
+{
+	const int nel = (int) mp.size()/8;
+	res.assign(mp.size(), 0.0);
+#ifdef _OPENMP
+	omp_set_num_threads(nthreads);
+#endif
+
+	double t = 0.0;
+	for (int r = 0; r <= nrep; r++) {
+		const auto t0 = std::chrono::steady_clock::now();
+		#pragma omp parallel for schedule(static)
+		for (int e = 0; e < nel; e++)
+			for (int n = 8*e; n < 8*e + 8; n++) {
+				const tens4dmm c = mat.SecantTangent(*mp[n]);
+				res[n] = c(0,0,0,0) + c(0,1,0,1);
+			}
+		const auto t1 = std::chrono::steady_clock::now();
+
+		// the first pass warms up the threads and caches
+		if (r > 0) t += std::chrono::duration<double, std::nano>(t1 - t0).count();
+	}
+
+	return t/((double) nrep*mp.size());
+}
+
+// throughput of the stress and tangent evaluation at 1 to nmax threads (doubling) for the prestress and
+// G&R branches, and whether the results are independent of the number of threads
+static void ThreadScaling(FEMbeCmm& mat, const char* szname, const BenchMesh& m, int nmax, int nrep)
+{
+	// material points at the 2x2x2 Gauss points of the elements
+	const double g = 1.0/sqrt(3.0);
+	static const int sr[8] = {-1, 1, 1, -1, -1, 1, 1, -1}, ss[8] = {-1, -1, 1, 1, -1, -1, 1, 1}, st[8] = {-1, -1, -1, -1, 1, 1, 1, 1};
+	std::vector<FEMaterialPoint*> mp;
+	for (int e = 0; e < m.Elements(); e++)
+		for (int q = 0; q < 8; q++) {
+			vec3d X(0, 0, 0);
+			for (int a = 0; a < 8; a++) X += m.X[m.el[8*e + a]]*(0.125*(1 + sr[a]*sr[q]*g)*(1 + ss[a]*ss[q]*g)*(1 + st[a]*st[q]*g));
+			FEMaterialPoint* p = new FEMaterialPoint(mat.CreateMaterialPointData());
+			p->m_r0 = X;
+			p->Init();
+			mp.push_back(p);
+		}
+
+	std::vector<int> nthreads;
+	for (int n = 1; n < nmax; n *= 2) nthreads.push_back(n);
+	nthreads.push_back(nmax);
+
+	printf("%s: %d elements, %d points, %d repeats\n", szname, m.Elements(), (int) mp.size(), nrep);
+	printf("%-10s %8s %12s %12s %9s %11s %10s\n", "branch", "threads", "ns/point", "Mpoints/s", "speedup", "efficiency", "results");
+
+	FETimeInfo& tp = mat.GetFEModel()->GetTime();
+	for (int branch = 0; branch < 2; branch++)
+	{
+		if (branch == 0) tp.currentTime = 1.0;
+		else {
+			// store the homeostatic state before entering G&R
+			SetDeformation(mp, tp.currentTime, 0.0);
+			for (size_t n = 0; n < mp.size(); n++) mat.Stress(*mp[n]);
+			tp.currentTime = 5.0;
+		}
+		for (size_t n = 0; n < mp.size(); n++) mp[n]->Update(tp);
+		SetDeformation(mp, tp.currentTime, 0.005);
+
+		std::vector<double> ref, res;
+		double t1 = 0.0;
+		for (size_t i = 0; i < nthreads.size(); i++)
+		{
+			const double tn = TimeParallel(mat, mp, nthreads[i], nrep, res);
+			if (i == 0) { t1 = tn; ref = res; }
+			printf("%-10s %8d %12.1f %12.3f %9.2f %10.1f%% %10s\n", (branch == 0 ? "prestress" : "G&R"), nthreads[i], tn, 1e3/tn,
+				t1/tn, 100.0*t1/tn/nthreads[i], (res == ref ? "identical" : "DIFFERENT"));
+		}
+	}
+	printf("\n");
+
+	for (size_t n = 0; n < mp.size(); n++) delete mp[n];
+}
+
+int main(int argc, char* argv[])
+{
+	int npts = 4096;
+	int nrep = 20;
+	bool bsave = false;
+	std::string baseline = "bench_baseline.txt";
+	std::string dumpFile, refFile;
+	std::vector<std::pair<std::string, double> > params;
+	bool bscaling = false, brep = false, bcheck = false;
+	int nthreads = 0;
+	std::string meshFile = "TAA-axi-4x200x1L-ht.feb";
+	int axi[3] = {4, 64, 50};
+
+	for (int i = 1; i < argc; i++) {
+		if      ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) npts = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) { nrep = atoi(argv[++i]); brep = true; }
+		else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc)) baseline = argv[++i];
+		else if  (strcmp(argv[i], "-save") == 0) bsave = true;
+		else if ((strcmp(argv[i], "-p") == 0) && (i + 2 < argc)) { params.push_back(std::make_pair(std::string(argv[i+1]), atof(argv[i+2]))); i += 2; }
+		else if ((strcmp(argv[i], "-dump") == 0) && (i + 1 < argc)) dumpFile = argv[++i];
+		else if ((strcmp(argv[i], "-accuracy") == 0) && (i + 1 < argc)) refFile = argv[++i];
+		else if  (strcmp(argv[i], "-check") == 0) bcheck = true;
+		else if  (strcmp(argv[i], "-scaling") == 0) bscaling = true;
+		else if ((strcmp(argv[i], "-threads") == 0) && (i + 1 < argc)) nthreads = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "-mesh") == 0) && (i + 1 < argc)) meshFile = argv[++i];
+		else if ((strcmp(argv[i], "-axi") == 0) && (i + 3 < argc)) { for (int k = 0; k < 3; k++) axi[k] = atoi(argv[++i]); }
+		else {
+			fprintf(stderr, "usage: %s [-n points] [-r repeats] [-b baseline] [-save] [-p name value ...] [-dump file | -accuracy file | -check]\n", argv[0]);
+			fprintf(stderr, "       %s -scaling [-threads N] [-mesh file] [-axi nr nt nz] [-r repeats] [-p name value ...]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (bscaling && !brep) nrep = 3;
+	if ((npts < 1) || (nrep < 1)) { fprintf(stderr, "invalid number of points or repeats\n"); return 1; }
+	if ((axi[0] < 1) || (axi[1] < 3) || (axi[2] < 1)) { fprintf(stderr, "invalid axisymmetric mesh size\n"); return 1; }
+
+	FEModel fem;
+	FEMbeCmm mat(&fem);
+	for (size_t i = 0; i < params.size(); i++) {
+		FEParam* p = mat.FindParameter(ParamString(params[i].first.c_str()));
+		if ((p == nullptr) || (p->type() != FE_PARAM_DOUBLE)) { fprintf(stderr, "unknown double parameter %s\n", params[i].first.c_str()); return 1; }
+		p->value<double>() = params[i].second;
+	}
+	if (!mat.Init()) { fprintf(stderr, "material initialization failed\n"); return 1; }
+
+	// thread scaling mode
+	if (bscaling) {
+#ifdef _OPENMP
+		if (nthreads < 1) nthreads = omp_get_num_procs();
+#else
+		fprintf(stderr, "the scaling mode needs a build with OpenMP (-fopenmp)\n");
+		return 1;
+#endif
+		fem.GetTime().timeIncrement = 1.0;
+
+		BenchMesh taa, cyl;
+		if (!ReadFebMesh(meshFile.c_str(), taa)) { fprintf(stderr, "cannot read the hex8 mesh of %s\n", meshFile.c_str()); return 1; }
+		AxisymmetricMesh(axi[0], axi[1], axi[2], cyl);
+
+		ThreadScaling(mat, meshFile.c_str(), taa, nthreads, nrep);
+		char szname[64];
+		snprintf(szname, sizeof(szname), "axisymmetric %dx%dx%d", axi[0], axi[1], axi[2]);
+		ThreadScaling(mat, szname, cyl, nthreads, nrep);
+		return 0;
+	}
+
+	// material points distributed over a cylindrical segment of the reference mesh
+	std::vector<FEMaterialPoint*> mp(npts);
+	for (int n = 0; n < npts; n++) {
+		mp[n] = new FEMaterialPoint(mat.CreateMaterialPointData());
+		const double r  = 0.6468 + 0.04*(n % 5)/4.0;
+		const double th = 2.0*M_PI*(n % 97)/97.0;
+		const double z  = 30.0*n/npts;
+		mp[n]->m_r0 = vec3d(r*cos(th), r*sin(th), z);
+		mp[n]->Init();
+	}
+
+	FETimeInfo& tp = fem.GetTime();
+	tp.timeIncrement = 1.0;
+
+	// accuracy modes
+	if (!dumpFile.empty() || !refFile.empty()) {
+		std::vector<double> res;
+		SampleStates(mat, mp, res);
+		for (int n = 0; n < npts; n++) delete mp[n];
+
+		if (!dumpFile.empty()) {
+			FILE* fp = fopen(dumpFile.c_str(), "wt");
+			if (fp == nullptr) { fprintf(stderr, "cannot write %s\n", dumpFile.c_str()); return 1; }
+			for (size_t i = 0; i < res.size(); i++) fprintf(fp, "%.17g\n", res[i]);
+			fclose(fp);
+			printf("%d values written to %s\n", (int) res.size(), dumpFile.c_str());
+			return 0;
+		}
+
+		std::vector<double> ref;
+		FILE* fp = fopen(refFile.c_str(), "rt");
+		if (fp == nullptr) { fprintf(stderr, "cannot open %s\n", refFile.c_str()); return 1; }
+		double v;
+		while (fscanf(fp, "%lf", &v) == 1) ref.push_back(v);
+		fclose(fp);
+		if (ref.size() != res.size()) { fprintf(stderr, "%s does not match the sampled states (same -n and -p needed)\n", refFile.c_str()); return 1; }
+
+		printf("%-26s %12s %12s\n", "check", "error", "bound");
+		bool bok = CheckMath();
+		bok = CheckSpectral() && bok;
+
+		// stress and tangent errors per point, relative to the largest reference component
+		const size_t nv = 42;
+		double es = 0.0, ec = 0.0;
+		for (size_t k = 0; k < res.size(); k += nv)
+		{
+			double ms = 0.0, mc = 0.0, ds = 0.0, dc = 0.0;
+			for (size_t i = 0; i < nv; i++) {
+				const double d = fabs(res[k + i] - ref[k + i]), m = fabs(ref[k + i]);
+				if (i < 6) { ds = std::max(ds, d); ms = std::max(ms, m); }
+				else { dc = std::max(dc, d); mc = std::max(mc, m); }
+			}
+			if (ms > 0.0) es = std::max(es, ds/ms);
+			if (mc > 0.0) ec = std::max(ec, dc/mc);
+		}
+		const double tol = 1e-13;
+		printf("%-26s %12.3g %12.3g\n", "stress (sampled states)", es, tol);
+		printf("%-26s %12.3g %12.3g\n", "tangent (sampled states)", ec, tol);
+		bok = bok && (es <= tol) && (ec <= tol);
+
+		printf("%s\n", (bok ? "accuracy check passed" : "accuracy check FAILED"));
+		return (bok ? 0 : 1);
+	}
+
+	// check mode
+	if (bcheck) {
+		printf("%-26s %12s %12s\n", "check", "error", "bound");
+		bool bok = CheckStressOnly(mat, mp);
+		bok = CheckTangentFD(mat, mp) && bok;
+		bok = CheckSpectral() && bok;
+		for (int n = 0; n < npts; n++) delete mp[n];
+
+		printf("%s\n", (bok ? "checks passed" : "checks FAILED"));
+		return (bok ? 0 : 1);
+	}
+
+	std::vector<std::pair<std::string, double> > res;
+
+	// prestress branch
+	tp.currentTime = 1.0;
+	for (int n = 0; n < npts; n++) mp[n]->Update(tp);
+	SetDeformation(mp, tp.currentTime, 0.005);
+	res.push_back(std::make_pair(std::string("prestress_stress"),         TimeCase(mat, mp, nrep, false)));
+	res.push_back(std::make_pair(std::string("prestress_stress_tangent"), TimeCase(mat, mp, nrep, true)));
+
+	// store the homeostatic state before entering G&R
+	SetDeformation(mp, tp.currentTime, 0.0);
+	for (int n = 0; n < npts; n++) mat.Stress(*mp[n]);
+	tp.currentTime = 5.0;
+	for (int n = 0; n < npts; n++) mp[n]->Update(tp);
+
+	// G&R branch
+	SetDeformation(mp, tp.currentTime, 0.005);
+	res.push_back(std::make_pair(std::string("gr_stress"),         TimeCase(mat, mp, nrep, false)));
+	res.push_back(std::make_pair(std::string("gr_stress_tangent"), TimeCase(mat, mp, nrep, true)));
+
+	// read baseline
+	std::map<std::string, double> base;
+	FILE* fp = fopen(baseline.c_str(), "rt");
+	if (fp) {
+		char name[256]; double v;
+		while (fscanf(fp, "%255s %lf", name, &v) == 2) base[name] = v;
+		fclose(fp);
+	}
+
+	printf("%d points, %d repeats\n", npts, nrep);
+	printf("%-26s %12s %12s %9s\n", "case", "ns/point", "baseline", "change");
+	for (size_t i = 0; i < res.size(); i++) {
+		std::map<std::string, double>::const_iterator it = base.find(res[i].first);
+		if (it != base.end())
+			printf("%-26s %12.1f %12.1f %8.1f%%\n", res[i].first.c_str(), res[i].second, it->second, 100.0*(res[i].second/it->second - 1.0));
+		else
+			printf("%-26s %12.1f %12s %9s\n", res[i].first.c_str(), res[i].second, "-", "-");
+	}
+
+	if (bsave) {
+		fp = fopen(baseline.c_str(), "wt");
+		if (fp == nullptr) { fprintf(stderr, "cannot write %s\n", baseline.c_str()); return 1; }
+		for (size_t i = 0; i < res.size(); i++) fprintf(fp, "%s %.3f\n", res[i].first.c_str(), res[i].second);
+		fclose(fp);
+		printf("baseline written to %s\n", baseline.c_str());
+	}
+
+	for (int n = 0; n < npts; n++) delete mp[n];
+
+	return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+
+# build and run the standalone material benchmark (arguments are passed to bench, see bench.cpp)
+# bench.sh -save stores the timings in bench_baseline.txt, later runs report the change against it
+# bench.sh -accuracy [args] compares the math layer with a libm build of the material on sampled states
+# bench.sh -check [args] compares the evaluation paths of the material (e.g. stress-only against stress and tangent)
+# bench.sh -scaling [args] reports the throughput at 1 to N threads on the TAA mesh and a generated mesh
+# (needs OMP_FLAGS=-fopenmp; OMP_FLAGS defaults to -fopenmp-simd, see build.sh)
+OMP_FLAGS=${OMP_FLAGS:--fopenmp-simd}
+g++ FEMbeCmm.cpp FEMbeCmmFanOut.cpp GRCenterline.cpp bench.cpp -o bench -std=c++11 -O3 $OMP_FLAGS -fno-trapping-math $SIMD_FLAGS -I../FEBio/ -L../FEBio/build/lib -Wl,-rpath,../FEBio/build/lib -lfebiomech -lfecore || exit 1
+
+if [ "$1" == "-accuracy" ]; then
+	shift
+	g++ FEMbeCmm.cpp FEMbeCmmFanOut.cpp GRCenterline.cpp bench.cpp -o bench_libm -DGR_LIBM_MATH -std=c++11 -O3 $OMP_FLAGS -fno-trapping-math $SIMD_FLAGS -I../FEBio/ -L../FEBio/build/lib -Wl,-rpath,../FEBio/build/lib -lfebiomech -lfecore || exit 1
+	./bench_libm -n 512 "$@" -dump bench_reference.txt || exit 1
+	./bench -n 512 "$@" -accuracy bench_reference.txt
+	exit $?
+fi
+
+./bench "$@"
@@ -1,3 +1,10 @@
 #!/bin/bash
 
-g++ -fPIC -shared FEMbeCmm.cpp dllmain.cpp -o FEMbeCmm.o -std=c++11 -I../FEBio/ -L../FEBio/build/lib -lfebiomech -lfecore
+# SIMD_FLAGS selects the target instruction set of the vectorized loops (GRVoigt.h, GRMath.h), e.g. SIMD_FLAGS=-mavx2;
+# add -DGR_SINGLE_PRECISION to store the derived per point quantities in single precision
+# (default: portable SSE2 code, double precision). -fno-trapping-math lets the clamped math functions
+# of GRMath.h vectorize (it does not change results, unlike -ffast-math). The material is thread-safe for
+# FEBio's parallel element loops. OMP_FLAGS defaults to -fopenmp-simd (the SIMD pragmas only, no runtime,
+# which also builds with Apple clang); OMP_FLAGS=-fopenmp gives each thread its own statistics counters
+OMP_FLAGS=${OMP_FLAGS:--fopenmp-simd}
+g++ -fPIC -shared FEMbeCmm.cpp FEMbeCmmPlot.cpp FEMbeCmmFanOut.cpp GRCenterline.cpp dllmain.cpp -o FEMbeCmm.o -std=c++11 -O3 $OMP_FLAGS -fno-trapping-math $SIMD_FLAGS -I../FEBio/ -L../FEBio/build/lib -lfebiomech -lfecore
@@ -2,6 +2,7 @@
 // with the FEBio framework. 
 #include <FECore/FECoreKernel.h>
 #include "FEMbeCmm.h"
+#include "FEMbeCmmPlot.h"
 
 //-----------------------------------------------------------------------------
 // This required function returns the version of the FEBio SDK that is being
@@ -27,6 +28,13 @@ FECORE_EXPORT void PluginInitialize(FECoreKernel& febio)
 	// This macro registers the new feature and assign a string to it that
 	// can be used to reference this class in the FEBio input file.
 	REGISTER_FECORE_CLASS(FEMbeCmm, "mbe_cmm");
+
+	// plot variables of the G&R state (element averages of the stored point data)
+	REGISTER_FECORE_CLASS(FEPlotGRphic                 , "GR phic");
+	REGISTER_FECORE_CLASS(FEPlotGRphim                 , "GR phim");
+	REGISTER_FECORE_CLASS(FEPlotGRrIrIo                , "GR rIrIo");
+	REGISTER_FECORE_CLASS(FEPlotGRCircumferentialStress, "GR circumferential stress");
+	REGISTER_FECORE_CLASS(FEPlotGRActiveRatio          , "GR active ratio");
 }
 
 //-----------------------------------------------------------------------------